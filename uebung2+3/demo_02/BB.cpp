@@ -1,85 +1,368 @@
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <limits>
 #include <QGLWidget>
 #include "vecmath.h"
 #include "BB.h"
 
 
-OBB::OBB(const std::vector<Vector3d>& vertices){
-    //calculate covariance matrix
+namespace {
+
+// feste Richtungen von DiTO-14: Koordinatenachsen und Raumdiagonalen
+const Vector3d ditoNormals[7] = {
+    Vector3d(1,0,0), Vector3d(0,1,0), Vector3d(0,0,1),
+    Vector3d(1,1,1), Vector3d(1,1,-1), Vector3d(1,-1,1), Vector3d(1,-1,-1)
+};
+
+// halbe Oberflaeche der Box mit Achsen u,v,w ueber den Punkten p
+double halfArea(const std::vector<Vector3d>& p, const Vector3d& u, const Vector3d& v, const Vector3d& w){
+    double lo[3], hi[3];
+    const Vector3d* axis[3]={&u,&v,&w};
+    for(int k=0; k<3; k++){
+        lo[k]=hi[k]=p[0]*(*axis[k]);
+    }
+    for(unsigned int i=1; i<p.size(); i++){
+        for(int k=0; k<3; k++){
+            double t=p[i]*(*axis[k]);
+            if(t<lo[k]) lo[k]=t;
+            if(t>hi[k]) hi[k]=t;
+        }
+    }
+    double x=hi[0]-lo[0], y=hi[1]-lo[1], z=hi[2]-lo[2];
+    return x*y+y*z+z*x;
+}
+
+// 2D-Punkt in der Projektionsebene
+struct Point2d {
+    double x, y;
+    bool operator<(const Point2d& q) const { return x<q.x || (x==q.x && y<q.y); }
+};
+
+inline double cross2d(const Point2d& o, const Point2d& a, const Point2d& b){
+    return (a.x-o.x)*(b.y-o.y)-(a.y-o.y)*(b.x-o.x);
+}
+
+// konvexe Huelle gegen den Uhrzeigersinn (Andrew's monotone chain)
+void convexHull2d(std::vector<Point2d>& q, std::vector<Point2d>& h){
+    std::sort(q.begin(), q.end());
+    int n=int(q.size()), k=0;
+    h.resize(2*n);
+    for(int i=0; i<n; i++){
+        while(k>=2 && cross2d(h[k-2], h[k-1], q[i])<=0) k--;
+        h[k++]=q[i];
+    }
+    for(int i=n-2, t=k+1; i>=0; i--){
+        while(k>=t && cross2d(h[k-2], h[k-1], q[i])<=0) k--;
+        h[k++]=q[i];
+    }
+    h.resize(k>1 ? k-1 : k);
+}
+
+// minimales umschliessendes Rechteck der Huelle h (rotating calipers),
+// liefert Flaeche und Richtung (ex,ey) der ersten Rechteckseite
+double minAreaRect(const std::vector<Point2d>& h, double& ex, double& ey){
+    int m=int(h.size());
+    ex=1; ey=0;
+    if(m<3) return 0;
+
+    double best=std::numeric_limits<double>::max();
+    int r=0, k=0, l=0;
+    for(int i=0; i<m; i++){
+        const Point2d& a=h[i];
+        const Point2d& b=h[(i+1)%m];
+        double len=sqrt((b.x-a.x)*(b.x-a.x)+(b.y-a.y)*(b.y-a.y));
+        if(len==0) continue;
+        double ux=(b.x-a.x)/len, uy=(b.y-a.y)/len;     // Kantenrichtung
+        double nx=-uy, ny=ux;                          // Innennormale
+
+        if(i==0) r=i;
+        // Calipers laufen monoton mit der Kante mit
+        while((h[(r+1)%m].x-h[r].x)*ux+(h[(r+1)%m].y-h[r].y)*uy>0) r=(r+1)%m;
+        if(i==0) k=r;
+        while((h[(k+1)%m].x-h[k].x)*nx+(h[(k+1)%m].y-h[k].y)*ny>0) k=(k+1)%m;
+        if(i==0) l=k;
+        while((h[(l+1)%m].x-h[l].x)*ux+(h[(l+1)%m].y-h[l].y)*uy<0) l=(l+1)%m;
+
+        double width=(h[r].x-h[l].x)*ux+(h[r].y-h[l].y)*uy;
+        double height=(h[k].x-a.x)*nx+(h[k].y-a.y)*ny;
+        if(width*height<best){
+            best=width*height;
+            ex=ux; ey=uy;
+        }
+    }
+    return best;
+}
+
+// beliebige Orthonormalbasis u,v der Ebene senkrecht zu n
+void planeBasis(const Vector3d& n, Vector3d& u, Vector3d& v){
+    Vector3d t=(fabs(n[0])<0.6) ? Vector3d(1,0,0) : Vector3d(0,1,0);
+    u=n%t;
+    u.normalize();
+    v=n%u;
+}
+
+}
+
+OBB::OBB(const std::vector<Vector3d>& vertices, FitMode mode){
     p=vertices;
+    init(mode, NULL);
+}
+
+OBB::OBB(const ConvexHull& hull, FitMode mode){
+    p=hull.points;
+    init(mode, hull.flat ? NULL : &hull);
+}
+
+void OBB::init(FitMode mode, const ConvexHull* hull){
     c11=0, c22=0, c33=0, c12=0, c13=0, c23=0;
+    nrot=0;
+    axis1=Vector3d(1,0,0);
+    axis2=Vector3d(0,1,0);
+    axis3=Vector3d(0,0,1);
+    center=Vector3d(0,0,0);
+    a1=a2=a3=0;
 
-    for(unsigned int i=0;i<p.size();i++) {
-        c11+=p[i][0]*p[i][0];
-        c22+=p[i][1]*p[i][1];
-        c33+=p[i][2]*p[i][2];
-        c12+=p[i][0]*p[i][1];
-        c13+=p[i][0]*p[i][2];
-        c23+=p[i][1]*p[i][2];
+    if(p.empty()){
+        return;
+    }
+
+    switch(mode){
+    case PCA:             fitPCA(hull);      break;
+    case DITO:            fitDiTO();         break;
+    case CALIPERS_APPROX: fitCalipers(hull); break;
+    }
+}
+
+void OBB::setAxes(const Vector3d& u, const Vector3d& v, const Vector3d& w){
+    axis1=u;
+    axis2=v;
+    axis3=w;
+
+    //Ausdehnung ueber die projizierten Punkte, nicht ueber die Eigenvektoren
+    double lo[3], hi[3];
+    const Vector3d* axis[3]={&axis1,&axis2,&axis3};
+    for(int k=0; k<3; k++){
+        lo[k]=hi[k]=p[0]*(*axis[k]);
+    }
+    for(unsigned int i=1; i<p.size(); i++){
+        for(int k=0; k<3; k++){
+            double t=p[i]*(*axis[k]);
+            if(t<lo[k]) lo[k]=t;
+            if(t>hi[k]) hi[k]=t;
+        }
+    }
+    a1=0.5*(hi[0]-lo[0]);
+    a2=0.5*(hi[1]-lo[1]);
+    a3=0.5*(hi[2]-lo[2]);
+    center=axis1*(0.5*(hi[0]+lo[0]))+axis2*(0.5*(hi[1]+lo[1]))+axis3*(0.5*(hi[2]+lo[2]));
+}
+
+void OBB::fitPCA(const ConvexHull* hull){
+    if(hull && hull->nr_of_faces()>0){
+        //covariance of the hull surface, each triangle weighted by its area
+        double area=0;
+        Vector3d mean;
+        for(int f=0; f<hull->nr_of_faces(); f++){
+            const Vector3d& a=p[hull->triangles[3*f]];
+            const Vector3d& b=p[hull->triangles[3*f+1]];
+            const Vector3d& t=p[hull->triangles[3*f+2]];
+            double A=0.5*((b-a)%(t-a)).length();
+            Vector3d m=(a+b+t)/3.0;
+            area+=A;
+            mean+=m*A;
+            c11+=A/12.0*(9*m[0]*m[0]+a[0]*a[0]+b[0]*b[0]+t[0]*t[0]);
+            c22+=A/12.0*(9*m[1]*m[1]+a[1]*a[1]+b[1]*b[1]+t[1]*t[1]);
+            c33+=A/12.0*(9*m[2]*m[2]+a[2]*a[2]+b[2]*b[2]+t[2]*t[2]);
+            c12+=A/12.0*(9*m[0]*m[1]+a[0]*a[1]+b[0]*b[1]+t[0]*t[1]);
+            c13+=A/12.0*(9*m[0]*m[2]+a[0]*a[2]+b[0]*b[2]+t[0]*t[2]);
+            c23+=A/12.0*(9*m[1]*m[2]+a[1]*a[2]+b[1]*b[2]+t[1]*t[2]);
+        }
+        mean/=area;
+        c11=c11/area-mean[0]*mean[0];
+        c22=c22/area-mean[1]*mean[1];
+        c33=c33/area-mean[2]*mean[2];
+        c12=c12/area-mean[0]*mean[1];
+        c13=c13/area-mean[0]*mean[2];
+        c23=c23/area-mean[1]*mean[2];
+    }
+    else{
+        //calculate covariance matrix around the centroid
+        Vector3d mean;
+        for(unsigned int i=0;i<p.size();i++) {
+            mean+=p[i];
+        }
+        mean/=double(p.size());
+
+        for(unsigned int i=0;i<p.size();i++) {
+            Vector3d r=p[i]-mean;
+            c11+=r[0]*r[0];
+            c22+=r[1]*r[1];
+            c33+=r[2]*r[2];
+            c12+=r[0]*r[1];
+            c13+=r[0]*r[2];
+            c23+=r[1]*r[2];
+        }
     }
     c=Matrix4d(c11,c12,c13,0,c12,c22,c23,0,c13,c23,c33,0,0,0,0,1);
     c.jacobi(d, V, nrot);
-    axis1=Vector3d(V(0,0), V(1,0), V(2,0));
-    axis2=Vector3d(V(0,1), V(1,1), V(2,1));
-    axis3=Vector3d(V(0,2), V(1,2), V(2,2));
-    a1=0;
-    a2=0;
-    a3=0;
-    std::cout <<"axis 1: " << axis1[0] << ", " << axis1[1] << ", " << axis1[2] << std::endl;
-    std::cout <<"axis 2: " << axis2[0] << ", " << axis2[1] << ", " << axis2[2] << std::endl;
-    std::cout <<"axis 3: " << axis3[0] << ", " << axis3[1] << ", " << axis3[2] << std::endl;
-//    std::cout <<"1. ev: " <<  axis1[0]  << std::endl;
-//    std::cout <<"2. ev: " <<  a2 << std::endl;
-//    std::cout <<"3. ev: " <<  a3 << std::endl;
 
-    for(int i=0; i<3; i++){
-        if(a1<V(0,i)){
-            a1=V(0,i);
+    Vector3d u(V(0,0), V(1,0), V(2,0));
+    Vector3d v(V(0,1), V(1,1), V(2,1));
+    u.normalize();
+    v.normalize();
+    setAxes(u, v, u%v);
+}
+
+void OBB::fitDiTO(){
+    //Extrempunkte entlang der 7 Richtungen
+    std::vector<Vector3d> s(14);
+    for(int k=0; k<7; k++){
+        double lo=p[0]*ditoNormals[k], hi=lo;
+        s[2*k]=s[2*k+1]=p[0];
+        for(unsigned int i=1; i<p.size(); i++){
+            double t=p[i]*ditoNormals[k];
+            if(t<lo){ lo=t; s[2*k]=p[i]; }
+            if(t>hi){ hi=t; s[2*k+1]=p[i]; }
+        }
+    }
+
+    //Startloesung: die AABB
+    Vector3d bu(1,0,0), bv(0,1,0), bw(0,0,1);
+    double best=halfArea(s, bu, bv, bw);
+
+    //Basisdreieck: entferntestes Extrempaar und der Punkt mit maximalem Abstand zur Geraden
+    int e=0;
+    for(int k=1; k<7; k++){
+        if((s[2*k+1]-s[2*k]).lengthSquared()>(s[2*e+1]-s[2*e]).lengthSquared()) e=k;
+    }
+    Vector3d p0=s[2*e], p1=s[2*e+1];
+    Vector3d e0=p1-p0;
+    if(e0.lengthSquared()==0){
+        setAxes(bu, bv, bw);
+        return;
+    }
+    e0.normalize();
+
+    Vector3d p2=p0;
+    double dmax=0;
+    for(int i=0; i<14; i++){
+        Vector3d r=s[i]-p0;
+        double dist=(r-e0*(r*e0)).lengthSquared();
+        if(dist>dmax){ dmax=dist; p2=s[i]; }
+    }
+
+    //Dreiecke des Ditetraeders (Basisdreieck und bis zu 6 Seitenflaechen)
+    std::vector<Vector3d> tri;
+    tri.push_back(p0); tri.push_back(p1); tri.push_back(p2);
+
+    Vector3d n=(p1-p0)%(p2-p0);
+    if(dmax>0 && n.lengthSquared()>0){
+        double lo=n*s[0], hi=lo;
+        Vector3d q0=s[0], q1=s[0];
+        for(int i=1; i<14; i++){
+            double t=n*s[i];
+            if(t<lo){ lo=t; q0=s[i]; }
+            if(t>hi){ hi=t; q1=s[i]; }
+        }
+        double base=n*p0;
+        Vector3d q[2]={q0,q1};
+        for(int j=0; j<2; j++){
+            if(fabs(n*q[j]-base)<=1e-12*n.length()) continue;
+            tri.push_back(p0); tri.push_back(p1); tri.push_back(q[j]);
+            tri.push_back(p1); tri.push_back(p2); tri.push_back(q[j]);
+            tri.push_back(p2); tri.push_back(p0); tri.push_back(q[j]);
         }
     }
-    for(int i=0; i<3; i++){
-        if(a2<V(1,i)){
-            a2=V(1,i);
+
+    //jede Dreieckskante liefert einen Kandidaten (Kante, Normale, Kante x Normale)
+    for(unsigned int t=0; t+2<tri.size(); t+=3){
+        Vector3d tn=(tri[t+1]-tri[t])%(tri[t+2]-tri[t]);
+        if(tn.lengthSquared()==0) continue;
+        tn.normalize();
+        for(int j=0; j<3; j++){
+            Vector3d u=tri[t+(j+1)%3]-tri[t+j];
+            if(u.lengthSquared()==0) continue;
+            u.normalize();
+            Vector3d w=u%tn;
+            double area=halfArea(s, u, tn, w);
+            if(area<best){
+                best=area;
+                bu=u; bv=tn; bw=w;
+            }
         }
     }
-    for(int i=0; i<3; i++){
-        if(a3<V(2,i)){
-            a3=V(2,i);
+
+    setAxes(bu, bv, bw);
+}
+
+void OBB::fitCalipers(const ConvexHull* hull){
+    //Kandidatenrichtungen: PCA-Achsen, DiTO-Achsen, die 13 Richtungen des 26-DOP
+    //und, falls vorhanden, alle Flaechennormalen der Huelle
+    std::vector<Vector3d> normals;
+    fitPCA(hull);
+    normals.push_back(axis1); normals.push_back(axis2); normals.push_back(axis3);
+    fitDiTO();
+    normals.push_back(axis1); normals.push_back(axis2); normals.push_back(axis3);
+    for(int x=-1; x<=1; x++)
+        for(int y=-1; y<=1; y++)
+            for(int z=0; z<=1; z++){
+                if(z==0 && (y<0 || (y==0 && x<=0))) continue;
+                normals.push_back(Vector3d(x,y,z).normalized());
+            }
+    if(hull){
+        normals.insert(normals.end(), hull->normals.begin(), hull->normals.end());
+    }
+
+    double best=volume();
+    Vector3d bu=axis1, bv=axis2, bw=axis3;
+
+    std::vector<Point2d> q(p.size()), h;
+    for(unsigned int j=0; j<normals.size(); j++){
+        const Vector3d& n=normals[j];
+        Vector3d u, v;
+        planeBasis(n, u, v);
+
+        double lo=p[0]*n, hi=lo;
+        for(unsigned int i=0; i<p.size(); i++){
+            q[i].x=p[i]*u;
+            q[i].y=p[i]*v;
+            double t=p[i]*n;
+            if(t<lo) lo=t;
+            if(t>hi) hi=t;
+        }
+        convexHull2d(q, h);
+
+        double ex, ey;
+        double vol=minAreaRect(h, ex, ey)*(hi-lo);
+        if(h.size()>=3 && vol<best){
+            best=vol;
+            bu=u*ex+v*ey;
+            bu.normalize();
+            bv=n%bu;
+            bw=n;
         }
     }
-    center=Vector3d(0,0,0);
-        std::cout <<"a1: " <<  a1  << std::endl;
-        std::cout <<"a2: " <<  a2 << std::endl;
-        std::cout <<"a3: " <<  a3 << std::endl;
 
+    setAxes(bu, bv, bw);
 }
 
 bool OBB::intersect(const OBB& B){
-    Vector3d c=center-B.center;
-    std::vector<Vector3d> v;
-    v.resize(15);
-    v.push_back(axis1);
-    v.push_back(axis2);
-    v.push_back(axis3);
-    v.push_back(B.axis1);
-    v.push_back(B.axis2);
-    v.push_back(B.axis3);
-    v.push_back(axis1%B.axis1);
-    v.push_back(axis1%B.axis2);
-    v.push_back(axis1%B.axis3);
-    v.push_back(axis2%B.axis1);
-    v.push_back(axis2%B.axis2);
-    v.push_back(axis2%B.axis3);
-    v.push_back(axis3%B.axis1);
-    v.push_back(axis3%B.axis2);
-    v.push_back(axis3%B.axis3);
-    for(unsigned int i=0; i<v.size(); i++){
-        if(v[i]*c < (a1*abs(axis1*v[i])+a2*abs(axis2*v[i])+a3*abs(axis3*v[i]) + B.a1*abs(B.axis1*v[i]) + B.a2*abs(B.axis2*v[i]) + B.a3*abs(B.axis3*v[i]))){
-            return true;
+    //separating axis test: 3+3 face normals and 9 edge cross products
+    Vector3d c=B.center-center;
+    Vector3d v[15]={axis1, axis2, axis3, B.axis1, B.axis2, B.axis3,
+                    axis1%B.axis1, axis1%B.axis2, axis1%B.axis3,
+                    axis2%B.axis1, axis2%B.axis2, axis2%B.axis3,
+                    axis3%B.axis1, axis3%B.axis2, axis3%B.axis3};
+    for(int i=0; i<15; i++){
+        if(v[i].lengthSquared()<1e-12) continue; //parallel edges
+        double rA=a1*fabs(axis1*v[i])+a2*fabs(axis2*v[i])+a3*fabs(axis3*v[i]);
+        double rB=B.a1*fabs(B.axis1*v[i])+B.a2*fabs(B.axis2*v[i])+B.a3*fabs(B.axis3*v[i]);
+        if(fabs(v[i]*c) > rA+rB){
+            return false;
         }
     }
-    return false;
+    return true;
 }
 
 void OBB::splitOBB(const OBB& A, OBB& A1, OBB& A2){
@@ -130,6 +413,16 @@ AABB::AABB(const std::vector<Vector3d> p){
             zmax=p[i][2];
         }
     }
+    updateCorners();
+}
+
+AABB::AABB(const Vector3d& min, const Vector3d& max){
+    xmin=min[0]; ymin=min[1]; zmin=min[2];
+    xmax=max[0]; ymax=max[1]; zmax=max[2];
+    updateCorners();
+}
+
+void AABB::updateCorners(){
     huellQuader[0]=Vector3d(xmin,ymin,zmin);
     huellQuader[1]=Vector3d(xmin,ymax,zmin);
     huellQuader[2]=Vector3d(xmin,ymin,zmax);
@@ -138,7 +431,16 @@ AABB::AABB(const std::vector<Vector3d> p){
     huellQuader[5]=Vector3d(xmax,ymin,zmax);
     huellQuader[6]=Vector3d(xmax,ymax,zmin);
     huellQuader[7]=Vector3d(xmax,ymax,zmax);
+}
 
+void AABB::merge(const AABB& B){
+    xmin=std::min(xmin,B.xmin);
+    ymin=std::min(ymin,B.ymin);
+    zmin=std::min(zmin,B.zmin);
+    xmax=std::max(xmax,B.xmax);
+    ymax=std::max(ymax,B.ymax);
+    zmax=std::max(zmax,B.zmax);
+    updateCorners();
 }
 
 
@@ -165,10 +467,181 @@ void AABB::draw(double rot, double gruen, double blau){
     glEnd();
 }
 
-bool AABB::intersect (const AABB& B){
+bool AABB::intersect (const AABB& B) const{
 
     if(xmax>=B.xmin && B.xmax>=xmin && ymax>=B.ymin && B.ymax>=ymin && zmax>=B.zmin && B.zmax>=zmin){
         return true;
     }
     return false;
 }
+
+bool AABB::contains (const AABB& B) const{
+    return xmin<=B.xmin && ymin<=B.ymin && zmin<=B.zmin && B.xmax<=xmax && B.ymax<=ymax && B.zmax<=zmax;
+}
+
+double AABB::area() const{
+    double dx=xmax-xmin, dy=ymax-ymin, dz=zmax-zmin;
+    return 2.0*(dx*dy+dy*dz+dz*dx);
+}
+
+bool AABB::intersectSegment (const Vector3d& from, const Vector3d& to, double& t) const{
+    //slabs: clip [0,1] against the entry and exit parameter of each axis
+    double lo[3]={xmin,ymin,zmin};
+    double hi[3]={xmax,ymax,zmax};
+    double t0=0, t1=1;
+    for(int k=0; k<3; k++){
+        double d=to[k]-from[k];
+        if(d==0){
+            if(from[k]<lo[k] || from[k]>hi[k]) return false;
+            continue;
+        }
+        double a=(lo[k]-from[k])/d;
+        double b=(hi[k]-from[k])/d;
+        if(a>b) std::swap(a,b);
+        t0=std::max(t0,a);
+        t1=std::min(t1,b);
+        if(t0>t1) return false;
+    }
+    t=t0;
+    return true;
+}
+
+Capsule::Capsule(const std::vector<Vector3d>& p) : radius(0) {
+    if(p.empty()){
+        return;
+    }
+    //Achse durch den Schwerpunkt entlang des Eigenvektors zum groessten
+    //Eigenwert der Kovarianz
+    Vector3d mean;
+    for(unsigned int i=0; i<p.size(); i++){
+        mean+=p[i];
+    }
+    mean/=double(p.size());
+    double c11=0, c22=0, c33=0, c12=0, c13=0, c23=0;
+    for(unsigned int i=0; i<p.size(); i++){
+        Vector3d r=p[i]-mean;
+        c11+=r[0]*r[0];
+        c22+=r[1]*r[1];
+        c33+=r[2]*r[2];
+        c12+=r[0]*r[1];
+        c13+=r[0]*r[2];
+        c23+=r[1]*r[2];
+    }
+    Matrix4d c(c11,c12,c13,0,c12,c22,c23,0,c13,c23,c33,0,0,0,0,0);
+    Matrix4d V;
+    Vector4d d;
+    int nrot;
+    c.jacobi(d, V, nrot);
+    int k=0;
+    for(int j=1; j<3; j++){
+        if(d[j]>d[k]) k=j;
+    }
+    Vector3d axis(V(0,k), V(1,k), V(2,k));
+    if(axis.lengthSquared()==0){
+        axis=Vector3d(1,0,0);
+    }
+    axis.normalize();
+
+    std::vector<double> r(p.size(), 0.0);
+    fit(&p[0], &r[0], int(p.size()), mean, axis);
+}
+
+void Capsule::fit(const Vector3d* c, const double* r, int n, const Vector3d& o, const Vector3d& axis){
+    //Radius: groesster Abstand (plus Kugelradius) zur Achse durch o
+    radius=0;
+    for(int i=0; i<n; i++){
+        Vector3d d=c[i]-o;
+        double dist=(d-axis*(d*axis)).length()+r[i];
+        if(dist>radius) radius=dist;
+    }
+
+    //Strecke [s0,s1] so kurz wie moeglich, die Halbkugeln decken die Enden ab
+    double s0=std::numeric_limits<double>::max();
+    double s1=-s0;
+    for(int i=0; i<n; i++){
+        Vector3d d=c[i]-o;
+        double t=d*axis;
+        double perp=(d-axis*t).lengthSquared();
+        double R=radius-r[i];
+        double h=sqrt(std::max(0.0, R*R-perp));
+        s0=std::min(s0, t+h);
+        s1=std::max(s1, t-h);
+    }
+    //s0>s1: eine einzige Kugel reicht
+    if(s0>s1){
+        s0=s1=0.5*(s0+s1);
+    }
+    p0=o+axis*s0;
+    p1=o+axis*s1;
+}
+
+void Capsule::merge(const Capsule& B){
+    Vector3d c[4]={p0, p1, B.p0, B.p1};
+    double r[4]={radius, radius, B.radius, B.radius};
+
+    //Achse entlang des entferntesten Endpunktpaares
+    Vector3d axis=p1-p0;
+    double best=-1;
+    for(int i=0; i<4; i++){
+        for(int j=i+1; j<4; j++){
+            double l=(c[j]-c[i]).lengthSquared();
+            if(l>best){ best=l; axis=c[j]-c[i]; }
+        }
+    }
+    if(axis.lengthSquared()==0){
+        axis=Vector3d(1,0,0);
+    }
+    axis.normalize();
+    //die Achse verbindet zwei Endpunkte, also durch c[0] legen reicht
+    fit(c, r, 4, c[0], axis);
+}
+
+double Capsule::volume() const {
+    double l=(p1-p0).length();
+    return M_PI*radius*radius*(l+4.0/3.0*radius);
+}
+
+bool Capsule::intersect(const Capsule& B) const {
+    double r=radius+B.radius;
+    return segmentDistanceSquared(p0, p1, B.p0, B.p1) <= r*r;
+}
+
+double Capsule::segmentDistanceSquared(const Vector3d& a0, const Vector3d& a1,
+                                       const Vector3d& b0, const Vector3d& b1){
+    //closest points on two segments (Ericson, Real-Time Collision Detection 5.1.9)
+    Vector3d d1=a1-a0, d2=b1-b0, r=a0-b0;
+    double a=d1*d1, e=d2*d2, f=d2*r;
+    double s, t;
+    const double eps=1e-12;
+
+    if(a<=eps && e<=eps){
+        return r*r;
+    }
+    if(a<=eps){
+        s=0;
+        t=std::min(std::max(f/e, 0.0), 1.0);
+    }
+    else{
+        double c=d1*r;
+        if(e<=eps){
+            t=0;
+            s=std::min(std::max(-c/a, 0.0), 1.0);
+        }
+        else{
+            double b=d1*d2;
+            double denom=a*e-b*b;
+            s=(denom!=0) ? std::min(std::max((b*f-c*e)/denom, 0.0), 1.0) : 0.0;
+            t=(b*s+f)/e;
+            if(t<0){
+                t=0;
+                s=std::min(std::max(-c/a, 0.0), 1.0);
+            }
+            else if(t>1){
+                t=1;
+                s=std::min(std::max((b-c)/a, 0.0), 1.0);
+            }
+        }
+    }
+    Vector3d d=(a0+d1*s)-(b0+d2*t);
+    return d*d;
+}
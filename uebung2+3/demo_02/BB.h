@@ -6,6 +6,7 @@
 #include <vecmath.h>
 #include <ostream>
 #include <vector>
+#include "ConvexHull.h"
 
 
 
@@ -13,18 +14,45 @@
 class OBB{
 public:
 
-    float c11, c22, c33, c12, c13, c23;
+    // PCA:      Hauptachsen der zentrierten Kovarianzmatrix
+    // DITO:     DiTO-14 (Larsson/Kaellberg), Achsen aus einem Ditetraeder
+    //           der Extrempunkte entlang 7 fester Richtungen
+    // CALIPERS_APPROX: Naeherung an die Box minimalen Volumens. Fuer
+    //           endlich viele Kandidatenrichtungen (PCA- und DiTO-Achsen,
+    //           13 Richtungen des 26-DOP, Flaechennormalen der Huelle) das
+    //           kleinste Rechteck per rotating calipers in der Ebene
+    //           senkrecht dazu; minimales Volumen gewinnt. Exakt nur, wenn
+    //           eine Seite der optimalen Box auf einer Huellflaeche liegt,
+    //           das exakte Verfahren (O'Rourke 1985) ist O(n^3).
+    enum FitMode { PCA, DITO, CALIPERS_APPROX };
+
+    double c11, c22, c33, c12, c13, c23;
     Vector3d axis1, axis2, axis3, center;
-    float a1, a2, a3;
+    // halbe Kantenlaengen entlang axis1..3
+    double a1, a2, a3;
     Matrix4d c;
     Matrix4d V;
     int nrot;
     Vector4d d;
     std::vector<Vector3d> p;
 
-    OBB(const std::vector<Vector3d>& vertices);
+    OBB(const std::vector<Vector3d>& vertices, FitMode mode = PCA);
+    // fit on the convex hull only: PCA uses the area weighted covariance
+    // of the hull surface, CALIPERS_APPROX also tries every hull face normal
+    OBB(const ConvexHull& hull, FitMode mode = PCA);
+    double volume() const { return 8.0*a1*a2*a3; }
     bool intersect(const OBB& B);
     void splitOBB(const OBB& A, OBB& A1, OBB& A2);
+
+private:
+
+    void init(FitMode mode, const ConvexHull* hull);
+    void fitPCA(const ConvexHull* hull);
+    void fitDiTO();
+    void fitCalipers(const ConvexHull* hull);
+
+    // setze axis1..3 (orthonormal) und berechne center, a1..a3 aus p
+    void setAxes(const Vector3d& u, const Vector3d& v, const Vector3d& w);
 };
 
 class AABB{
@@ -32,9 +60,48 @@ public:
     Vector3d huellQuader [8];
     double xmin,xmax, ymin, ymax, zmin, zmax;
     AABB(const std::vector<Vector3d> p);
-    bool intersect (const AABB& B);
+    AABB(const Vector3d& min, const Vector3d& max);
+    bool intersect (const AABB& B) const;
+    // B liegt ganz in dieser Box
+    bool contains (const AABB& B) const;
+    double area() const;
+    // Eintrittsparameter t in [0,1] der Strecke from-to, false wenn sie die Box verfehlt
+    bool intersectSegment (const Vector3d& from, const Vector3d& to, double& t) const;
+    void merge(const AABB& B);
     void draw(double rot, double gruen, double blau);
+
+private:
+    void updateCorners();
+};
+
+// Kapsel: alle Punkte mit Abstand <= radius zur Strecke p0-p1.
+// Passt fuer laengliche Teile viel enger als eine Kugel und ist
+// billiger zu testen als eine OBB.
+class Capsule{
+public:
+    Vector3d p0, p1;
+    double radius;
+
+    Capsule() : radius(0) {}
+    Capsule(const Vector3d& a, const Vector3d& b, double r) : p0(a), p1(b), radius(r) {}
+    // Achse = Hauptachse der Punkte durch ihren Schwerpunkt,
+    // Radius = maximaler Abstand zur Achse
+    Capsule(const std::vector<Vector3d>& p);
+    bool intersect(const Capsule& B) const;
+    // kleinste Kapsel (entlang der laengsten Endpunktrichtung), die beide enthaelt
+    void merge(const Capsule& B);
+    double volume() const;
+
+    // quadrierter Abstand der Strecken a0-a1 und b0-b1
+    static double segmentDistanceSquared(const Vector3d& a0, const Vector3d& a1,
+                                         const Vector3d& b0, const Vector3d& b1);
+
+private:
+    // Kapsel um n Kugeln (c[i], r[i]) mit der Achse o+t*axis
+    void fit(const Vector3d* c, const double* r, int n, const Vector3d& o, const Vector3d& axis);
 };
 
+#include "KDOP.h"
+
 
 #endif // BB_H
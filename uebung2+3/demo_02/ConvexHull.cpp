@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "ConvexHull.h"
+
+ConvexHull::ConvexHull(const std::vector<Vector3d>& input) : flat(false), P(&input) {
+    build();
+    faces.clear();
+    P=NULL;
+}
+
+int ConvexHull::addFace(int a, int b, int c) {
+    Face f;
+    f.v[0]=a; f.v[1]=b; f.v[2]=c;
+    f.adj[0]=f.adj[1]=f.adj[2]=-1;
+    f.n=(pt(b)-pt(a))%(pt(c)-pt(a));
+    f.n.normalize();
+    f.d=f.n*pt(a);
+    f.furthest=-1;
+    f.alive=true;
+    f.visible=false;
+    faces.push_back(f);
+    return int(faces.size())-1;
+}
+
+void ConvexHull::build() {
+    int n=int(P->size());
+    if(n<4){
+        makeFlat();
+        return;
+    }
+
+    //tolerance relative to the extent of the input
+    Vector3d maxAbs;
+    int ext[6]={0,0,0,0,0,0};
+    for(int i=0; i<n; i++){
+        for(int k=0; k<3; k++){
+            maxAbs[k]=std::max(maxAbs[k], fabs(pt(i)[k]));
+            if(pt(i)[k]<pt(ext[2*k])[k]) ext[2*k]=i;
+            if(pt(i)[k]>pt(ext[2*k+1])[k]) ext[2*k+1]=i;
+        }
+    }
+    eps=3*DBL_EPSILON*(maxAbs[0]+maxAbs[1]+maxAbs[2]);
+
+    //initial tetrahedron: widest extremal pair, farthest point from that
+    //line and farthest point from the resulting plane
+    int i0=ext[0], i1=ext[1];
+    for(int k=1; k<3; k++){
+        if((pt(ext[2*k+1])-pt(ext[2*k])).lengthSquared()>(pt(i1)-pt(i0)).lengthSquared()){
+            i0=ext[2*k]; i1=ext[2*k+1];
+        }
+    }
+    Vector3d e=pt(i1)-pt(i0);
+    if(e.length()<=eps){
+        makeFlat();
+        return;
+    }
+    e.normalize();
+
+    int i2=-1;
+    double dmax=eps;
+    for(int i=0; i<n; i++){
+        Vector3d r=pt(i)-pt(i0);
+        double dist=(r-e*(r*e)).length();
+        if(dist>dmax){ dmax=dist; i2=i; }
+    }
+    if(i2<0){
+        makeFlat();
+        return;
+    }
+
+    Vector3d pn=(pt(i1)-pt(i0))%(pt(i2)-pt(i0));
+    pn.normalize();
+    int i3=-1;
+    dmax=eps;
+    for(int i=0; i<n; i++){
+        double dist=fabs((pt(i)-pt(i0))*pn);
+        if(dist>dmax){ dmax=dist; i3=i; }
+    }
+    if(i3<0){
+        makeFlat();
+        return;
+    }
+
+    //orient the tetrahedron so that all faces point outwards
+    if((pt(i3)-pt(i0))*pn>0) std::swap(i1,i2);
+    addFace(i0,i1,i2);
+    addFace(i0,i3,i1);
+    addFace(i1,i3,i2);
+    addFace(i2,i3,i0);
+    for(int f=0; f<4; f++){
+        for(int j=0; j<3; j++){
+            int a=faces[f].v[j], b=faces[f].v[(j+1)%3];
+            for(int g=0; g<4; g++){
+                if(g==f) continue;
+                for(int k=0; k<3; k++){
+                    if(faces[g].v[k]==b && faces[g].v[(k+1)%3]==a) faces[f].adj[j]=g;
+                }
+            }
+        }
+    }
+
+    //parallel initial partition: every point is assigned to the face it
+    //is farthest in front of, points inside the tetrahedron are dropped
+    std::vector<int> owner(n);
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++){
+        int best=-1;
+        double bestDist=eps;
+        for(int f=0; f<4; f++){
+            double dist=distance(faces[f],i);
+            if(dist>bestDist){ bestDist=dist; best=f; }
+        }
+        owner[i]=best;
+    }
+    for(int i=0; i<n; i++){
+        if(owner[i]<0 || i==i0 || i==i1 || i==i2 || i==i3) continue;
+        Face& f=faces[owner[i]];
+        f.outside.push_back(i);
+        if(f.furthest<0 || distance(f,i)>distance(f,f.furthest)) f.furthest=i;
+    }
+
+    //expand the hull until no face has outside points left
+    std::vector<int> pending;
+    for(int f=0; f<4; f++) pending.push_back(f);
+    while(!pending.empty()){
+        int f=pending.back();
+        pending.pop_back();
+        if(!faces[f].alive || faces[f].outside.empty()) continue;
+
+        int first=int(faces.size());
+        addPoint(f);
+        for(int g=first; g<int(faces.size()); g++){
+            if(!faces[g].outside.empty()) pending.push_back(g);
+        }
+    }
+
+    finish();
+}
+
+// depth first search over the faces visible from the eye point. The
+// horizon edges (face, edge) are collected in counter-clockwise order.
+void ConvexHull::computeHorizon(int f, int edge, int eye, std::vector<int>& horizon, std::vector<int>& visible) {
+    faces[f].visible=true;
+    visible.push_back(f);
+
+    int start=(edge<0) ? 0 : edge+1;
+    int count=(edge<0) ? 3 : 2;
+    for(int k=0; k<count; k++){
+        int j=(start+k)%3;
+        int g=faces[f].adj[j];
+        if(faces[g].visible) continue;
+        if(distance(faces[g],eye)>eps){
+            int twin=0;
+            while(faces[g].adj[twin]!=f) twin++;
+            computeHorizon(g,twin,eye,horizon,visible);
+        }
+        else{
+            horizon.push_back(f);
+            horizon.push_back(j);
+        }
+    }
+}
+
+void ConvexHull::addPoint(int f) {
+    int eye=faces[f].furthest;
+
+    std::vector<int> horizon, visible;
+    computeHorizon(f,-1,eye,horizon,visible);
+
+    //one new face per horizon edge, glued to the face behind the edge
+    int first=int(faces.size());
+    int m=int(horizon.size())/2;
+    for(int k=0; k<m; k++){
+        int hf=horizon[2*k], j=horizon[2*k+1];
+        int a=faces[hf].v[j], b=faces[hf].v[(j+1)%3];
+        int behind=faces[hf].adj[j];
+        int g=addFace(a,b,eye);
+        faces[g].adj[0]=behind;
+        for(int t=0; t<3; t++){
+            if(faces[behind].adj[t]==hf) faces[behind].adj[t]=g;
+        }
+    }
+    //consecutive new faces share the edges through the eye point
+    for(int k=0; k<m; k++){
+        int g=first+k, h=first+(k+1)%m;
+        faces[g].adj[1]=h;
+        faces[h].adj[2]=g;
+    }
+
+    //hand the outside points of the removed faces to the new faces
+    for(unsigned int k=0; k<visible.size(); k++){
+        Face& old=faces[visible[k]];
+        for(unsigned int t=0; t<old.outside.size(); t++){
+            int i=old.outside[t];
+            if(i==eye) continue;
+            for(int g=first; g<int(faces.size()); g++){
+                Face& nf=faces[g];
+                double dist=distance(nf,i);
+                if(dist>eps){
+                    nf.outside.push_back(i);
+                    if(nf.furthest<0 || dist>distance(nf,nf.furthest)) nf.furthest=i;
+                    break;
+                }
+            }
+        }
+        old.alive=false;
+        std::vector<int>().swap(old.outside);
+    }
+}
+
+void ConvexHull::finish() {
+    std::vector<int> remap(P->size(),-1);
+    for(unsigned int f=0; f<faces.size(); f++){
+        if(!faces[f].alive) continue;
+        for(int j=0; j<3; j++){
+            int v=faces[f].v[j];
+            if(remap[v]<0){
+                remap[v]=int(vertices.size());
+                vertices.push_back(v);
+                points.push_back(pt(v));
+            }
+            triangles.push_back(remap[v]);
+        }
+        normals.push_back(faces[f].n);
+    }
+
+    //every directed edge a->b of the closed hull appears exactly once
+    int nv=int(points.size());
+    neighbourStart.assign(nv+1,0);
+    for(unsigned int t=0; t<triangles.size(); t++){
+        neighbourStart[triangles[t]+1]++;
+    }
+    for(int i=0; i<nv; i++){
+        neighbourStart[i+1]+=neighbourStart[i];
+    }
+    neighbours.resize(triangles.size());
+    std::vector<int> fill(neighbourStart.begin(), neighbourStart.end()-1);
+    for(unsigned int t=0; t<triangles.size(); t+=3){
+        for(int j=0; j<3; j++){
+            int a=triangles[t+j], b=triangles[t+(j+1)%3];
+            neighbours[fill[a]++]=b;
+        }
+    }
+}
+
+namespace {
+
+struct LessByPoint {
+    const std::vector<Vector3d>& P;
+    LessByPoint(const std::vector<Vector3d>& p) : P(p) {}
+    bool operator()(int a, int b) const { return P[a]<P[b]; }
+};
+
+}
+
+void ConvexHull::makeFlat() {
+    flat=true;
+    std::vector<int> order(P->size());
+    for(unsigned int i=0; i<order.size(); i++) order[i]=i;
+    std::sort(order.begin(), order.end(), LessByPoint(*P));
+    for(unsigned int k=0; k<order.size(); k++){
+        if(k>0 && pt(order[k])==pt(order[k-1])) continue;
+        vertices.push_back(order[k]);
+        points.push_back(pt(order[k]));
+    }
+}
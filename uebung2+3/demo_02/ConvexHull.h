@@ -0,0 +1,66 @@
+#ifndef CONVEXHULL_H
+#define CONVEXHULL_H
+
+#include <vector>
+#include "vecmath.h"
+
+// 3D convex hull (quickhull) as a preprocessing stage: Welzl, OBB fitting
+// and GJK support mapping only ever need the hull of the input points.
+// The initial partition of the points onto the faces of the starting
+// tetrahedron runs in parallel (OpenMP).
+class ConvexHull {
+public:
+
+    ConvexHull(const std::vector<Vector3d>& input);
+
+    // index of every hull vertex in the input array
+    std::vector<int> vertices;
+    // positions of the hull vertices
+    std::vector<Vector3d> points;
+    // 3 indices per face into points, counter-clockwise seen from outside
+    std::vector<int> triangles;
+    // outward unit normal of every face
+    std::vector<Vector3d> normals;
+
+    // vertex adjacency in CSR layout: the neighbours of hull vertex i are
+    // neighbours[neighbourStart[i]] .. neighbours[neighbourStart[i+1]-1]
+    std::vector<int> neighbourStart;
+    std::vector<int> neighbours;
+
+    // true if the input is (numerically) flat, i.e. coplanar, collinear or
+    // a single point. points then holds the distinct input points and
+    // there are no faces and no adjacency.
+    bool flat;
+
+    int nr_of_vertices() const { return int(points.size()); }
+    int nr_of_faces() const { return int(triangles.size()/3); }
+
+private:
+
+    struct Face {
+        int v[3];
+        // neighbouring face across edge v[i] -> v[(i+1)%3]
+        int adj[3];
+        Vector3d n;
+        double d;
+        std::vector<int> outside;
+        int furthest;
+        bool alive, visible;
+    };
+
+    // input points, only valid while the hull is being built
+    const std::vector<Vector3d>* P;
+    std::vector<Face> faces;
+    double eps;
+
+    const Vector3d& pt(int i) const { return (*P)[i]; }
+    double distance(const Face& f, int i) const { return f.n*pt(i)-f.d; }
+    int addFace(int a, int b, int c);
+    void computeHorizon(int f, int edge, int eye, std::vector<int>& horizon, std::vector<int>& visible);
+    void addPoint(int f);
+    void build();
+    void finish();
+    void makeFlat();
+};
+
+#endif // CONVEXHULL_H
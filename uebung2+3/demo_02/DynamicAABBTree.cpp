@@ -0,0 +1,310 @@
+#include <algorithm>
+#include "DynamicAABBTree.h"
+
+
+namespace {
+
+AABB merged(const AABB& a, const AABB& b){
+    AABB c=a;
+    c.merge(b);
+    return c;
+}
+
+}
+
+DynamicAABBTree::DynamicAABBTree(double margin, double predict)
+    : root(-1), freeList(-1), leafCount(0), margin(margin), predict(predict) {
+}
+
+int DynamicAABBTree::allocate(){
+    if(freeList<0){
+        //grow the pool and chain the new nodes into the free list
+        int n=int(nodes.size());
+        int grown=std::max(16,2*n);
+        nodes.resize(grown);
+        for(int i=n; i<grown; i++){
+            nodes[i].parent=i+1<grown ? i+1 : -1;
+        }
+        freeList=n;
+    }
+    int node=freeList;
+    freeList=nodes[node].parent;
+    nodes[node]=Node();
+    nodes[node].height=0;
+    return node;
+}
+
+void DynamicAABBTree::release(int node){
+    nodes[node].height=-1;
+    nodes[node].moved=false;
+    nodes[node].parent=freeList;
+    freeList=node;
+}
+
+AABB DynamicAABBTree::fatten(const AABB& box, const Vector3d& displacement) const{
+    Vector3d lo(box.xmin-margin,box.ymin-margin,box.zmin-margin);
+    Vector3d hi(box.xmax+margin,box.ymax+margin,box.zmax+margin);
+    Vector3d d=displacement*predict;
+    for(int k=0; k<3; k++){
+        if(d[k]<0) lo[k]+=d[k];
+        else hi[k]+=d[k];
+    }
+    return AABB(lo,hi);
+}
+
+int DynamicAABBTree::add(const AABB& box){
+    int proxy=allocate();
+    nodes[proxy].box=fatten(box,Vector3d(0,0,0));
+    insertLeaf(proxy);
+    leafCount++;
+    nodes[proxy].moved=true;
+    moveBuffer.push_back(proxy);
+    return proxy;
+}
+
+void DynamicAABBTree::remove(int proxy){
+    if(nodes[proxy].moved){
+        //the id may come back with add() before the next movedPairs
+        std::vector<int>::iterator i=std::find(moveBuffer.begin(),moveBuffer.end(),proxy);
+        *i=moveBuffer.back();
+        moveBuffer.pop_back();
+    }
+    removeLeaf(proxy);
+    release(proxy);
+    leafCount--;
+}
+
+bool DynamicAABBTree::move(int proxy, const AABB& box, const Vector3d& displacement){
+    const AABB& fat=nodes[proxy].box;
+    //stay while the object is inside and the fat box is not far too large,
+    //e.g. after a fast move
+    if(fat.contains(box)){
+        Vector3d lo(box.xmin-4*margin,box.ymin-4*margin,box.zmin-4*margin);
+        Vector3d hi(box.xmax+4*margin,box.ymax+4*margin,box.zmax+4*margin);
+        Vector3d d=displacement*(4*predict);
+        for(int k=0; k<3; k++){
+            if(d[k]<0) lo[k]+=d[k];
+            else hi[k]+=d[k];
+        }
+        if(AABB(lo,hi).contains(fat)) return false;
+    }
+    removeLeaf(proxy);
+    nodes[proxy].box=fatten(box,displacement);
+    insertLeaf(proxy);
+    if(!nodes[proxy].moved){
+        nodes[proxy].moved=true;
+        moveBuffer.push_back(proxy);
+    }
+    return true;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf){
+    if(root<0){
+        root=leaf;
+        nodes[root].parent=-1;
+        return;
+    }
+
+    //descend while pushing the leaf further down is cheaper than pairing it
+    //with the current node; costs are surface areas
+    const AABB box=nodes[leaf].box;
+    int index=root;
+    while(!nodes[index].leaf()){
+        double area=nodes[index].box.area();
+        double combinedArea=merged(nodes[index].box,box).area();
+        //a new parent of index and leaf
+        double cost=2*combinedArea;
+        //every node below index grows at least by this
+        double inheritance=2*(combinedArea-area);
+
+        double childCost[2];
+        int child[2]={nodes[index].child1,nodes[index].child2};
+        for(int c=0; c<2; c++){
+            const Node& n=nodes[child[c]];
+            double a=merged(n.box,box).area();
+            childCost[c]=(n.leaf() ? a : a-n.box.area())+inheritance;
+        }
+        if(cost<childCost[0] && cost<childCost[1]) break;
+        index=childCost[0]<childCost[1] ? child[0] : child[1];
+    }
+
+    //index becomes the sibling of leaf under a new parent
+    int sibling=index;
+    int oldParent=nodes[sibling].parent;
+    int newParent=allocate();
+    nodes[newParent].parent=oldParent;
+    nodes[newParent].box=merged(box,nodes[sibling].box);
+    nodes[newParent].height=nodes[sibling].height+1;
+    nodes[newParent].child1=sibling;
+    nodes[newParent].child2=leaf;
+    nodes[sibling].parent=newParent;
+    nodes[leaf].parent=newParent;
+    if(oldParent<0){
+        root=newParent;
+    }else if(nodes[oldParent].child1==sibling){
+        nodes[oldParent].child1=newParent;
+    }else{
+        nodes[oldParent].child2=newParent;
+    }
+    refit(newParent);
+}
+
+void DynamicAABBTree::removeLeaf(int leaf){
+    if(leaf==root){
+        root=-1;
+        return;
+    }
+    int parent=nodes[leaf].parent;
+    int grandParent=nodes[parent].parent;
+    int sibling=nodes[parent].child1==leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    //the sibling takes the place of the parent
+    nodes[sibling].parent=grandParent;
+    release(parent);
+    if(grandParent<0){
+        root=sibling;
+        return;
+    }
+    if(nodes[grandParent].child1==parent){
+        nodes[grandParent].child1=sibling;
+    }else{
+        nodes[grandParent].child2=sibling;
+    }
+    refit(grandParent);
+}
+
+void DynamicAABBTree::refit(int node){
+    while(node>=0){
+        node=balance(node);
+        Node& n=nodes[node];
+        const Node& c1=nodes[n.child1];
+        const Node& c2=nodes[n.child2];
+        n.height=1+std::max(c1.height,c2.height);
+        n.box=merged(c1.box,c2.box);
+        node=n.parent;
+    }
+}
+
+int DynamicAABBTree::balance(int a){
+    const Node& A=nodes[a];
+    if(A.leaf() || A.height<2) return a;
+    int b=A.child1, c=A.child2;
+    int difference=nodes[c].height-nodes[b].height;
+    if(difference>1) return rotate(a,c,b);
+    if(difference<-1) return rotate(a,b,c);
+    return a;
+}
+
+// The higher child up of a takes the place of a, a becomes its child. Of
+// the two children of up the higher one stays, the lower one moves down to
+// a next to other. Returns up.
+int DynamicAABBTree::rotate(int a, int up, int other){
+    Node& A=nodes[a];
+    Node& U=nodes[up];
+    int f=U.child1, g=U.child2;
+    if(nodes[f].height<nodes[g].height) std::swap(f,g);
+
+    U.child1=a;
+    U.child2=f;
+    U.parent=A.parent;
+    A.parent=up;
+    if(U.parent<0){
+        root=up;
+    }else if(nodes[U.parent].child1==a){
+        nodes[U.parent].child1=up;
+    }else{
+        nodes[U.parent].child2=up;
+    }
+
+    if(A.child1==up) A.child1=g;
+    else A.child2=g;
+    nodes[g].parent=a;
+
+    A.box=merged(nodes[other].box,nodes[g].box);
+    A.height=1+std::max(nodes[other].height,nodes[g].height);
+    U.box=merged(A.box,nodes[f].box);
+    U.height=1+std::max(A.height,nodes[f].height);
+    return up;
+}
+
+void DynamicAABBTree::query(const AABB& box, std::vector<int>& result) const{
+    result.clear();
+    if(root<0) return;
+    std::vector<int> stack;
+    stack.push_back(root);
+    while(!stack.empty()){
+        int node=stack.back();
+        stack.pop_back();
+        const Node& n=nodes[node];
+        if(!n.box.intersect(box)) continue;
+        if(n.leaf()){
+            result.push_back(node);
+        }else{
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+        }
+    }
+}
+
+void DynamicAABBTree::rayCast(const Vector3d& from, const Vector3d& to, std::vector<std::pair<double,int> >& hits) const{
+    hits.clear();
+    if(root<0) return;
+    std::vector<int> stack;
+    stack.push_back(root);
+    while(!stack.empty()){
+        int node=stack.back();
+        stack.pop_back();
+        const Node& n=nodes[node];
+        double t;
+        if(!n.box.intersectSegment(from,to,t)) continue;
+        if(n.leaf()){
+            hits.push_back(std::make_pair(t,node));
+        }else{
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+        }
+    }
+    std::sort(hits.begin(),hits.end());
+}
+
+void DynamicAABBTree::movedPairs(std::vector<std::pair<int,int> >& pairs, std::vector<int>* moved){
+    pairs.clear();
+    if(moved) *moved=moveBuffer;
+    std::vector<int> hits;
+    for(unsigned int i=0; i<moveBuffer.size(); i++){
+        int proxy=moveBuffer[i];
+        query(nodes[proxy].box,hits);
+        for(unsigned int k=0; k<hits.size(); k++){
+            int other=hits[k];
+            if(other==proxy) continue;
+            //a pair of two moved proxies is reported by the smaller one
+            if(nodes[other].moved && other<proxy) continue;
+            pairs.push_back(std::make_pair(std::min(proxy,other),std::max(proxy,other)));
+        }
+    }
+    for(unsigned int i=0; i<moveBuffer.size(); i++){
+        nodes[moveBuffer[i]].moved=false;
+    }
+    moveBuffer.clear();
+}
+
+void DynamicAABBTree::allPairs(std::vector<std::pair<int,int> >& pairs) const{
+    pairs.clear();
+    std::vector<int> hits;
+    for(unsigned int i=0; i<nodes.size(); i++){
+        if(nodes[i].height!=0) continue;
+        query(nodes[i].box,hits);
+        for(unsigned int k=0; k<hits.size(); k++){
+            if(int(i)<hits[k]) pairs.push_back(std::make_pair(int(i),hits[k]));
+        }
+    }
+}
+
+double DynamicAABBTree::areaRatio() const{
+    if(root<0) return 0.0;
+    double sum=0;
+    for(unsigned int i=0; i<nodes.size(); i++){
+        if(nodes[i].height>0) sum+=nodes[i].box.area();
+    }
+    return sum/nodes[root].box.area();
+}
@@ -0,0 +1,87 @@
+#ifndef DYNAMICAABBTREE_H
+#define DYNAMICAABBTREE_H
+
+#include <vector>
+#include <utility>
+#include "BB.h"
+
+// Dynamic bounding volume tree over fattened AABBs for objects that are
+// added, removed and moved at runtime. Every leaf stores the tight box of
+// its object enlarged by a margin and by the predicted displacement; as
+// long as the object stays inside that fat box nothing changes, otherwise
+// the leaf is removed and reinserted. Leaves go down the branch of the
+// smallest surface area increase, and subtrees whose children differ in
+// height by more than one are rotated back into balance on the way up.
+// Nodes live in one array with a free list. A frame costs O(log n) per
+// reinserted leaf plus one query per reinserted leaf, independent of the
+// number of objects that stayed inside their fat boxes.
+class DynamicAABBTree{
+public:
+    // margin: enlargement of every fat box on each side;
+    // predict: multiple of the displacement passed to move() added in
+    // the direction of motion
+    DynamicAABBTree(double margin=0.1, double predict=2.0);
+
+    // insert an object with tight bounds box, returns its proxy id
+    int add(const AABB& box);
+    void remove(int proxy);
+    // new tight bounds after moving by displacement; returns true if the
+    // leaf had to be reinserted
+    bool move(int proxy, const AABB& box, const Vector3d& displacement);
+
+    const AABB& fatBox(int proxy) const { return nodes[proxy].box; }
+    bool testOverlap(int a, int b) const { return nodes[a].box.intersect(nodes[b].box); }
+
+    // proxies whose fat box overlaps box
+    void query(const AABB& box, std::vector<int>& result) const;
+    // proxies whose fat box the segment from-to hits, as (t, proxy) sorted
+    // by the entry parameter t in [0,1]
+    void rayCast(const Vector3d& from, const Vector3d& to, std::vector<std::pair<double,int> >& hits) const;
+    // pairs of overlapping fat boxes of which at least one was added or
+    // reinserted since the last call, each pair once with first<second;
+    // moved gets these added or reinserted proxies. Pairs of objects that
+    // both stay inside their fat boxes do not change, so dropping the
+    // earlier pairs of the moved proxies and adding the new ones keeps all
+    // overlapping pairs in time proportional to the moved proxies.
+    void movedPairs(std::vector<std::pair<int,int> >& pairs, std::vector<int>* moved=NULL);
+    // all pairs of overlapping fat boxes, first<second
+    void allPairs(std::vector<std::pair<int,int> >& pairs) const;
+
+    int height() const { return root<0 ? 0 : nodes[root].height; }
+    int size() const { return leafCount; }
+    // surface area of all inner nodes over that of the root, smaller means
+    // cheaper queries
+    double areaRatio() const;
+
+private:
+    struct Node{
+        AABB box;
+        // next node of the free list while the node is unused
+        int parent;
+        int child1, child2;
+        // 0 for leaves, -1 for unused nodes
+        int height;
+        bool moved;
+
+        Node() : box(Vector3d(0,0,0),Vector3d(0,0,0)), parent(-1), child1(-1), child2(-1), height(-1), moved(false) {}
+        bool leaf() const { return child1<0; }
+    };
+
+    std::vector<Node> nodes;
+    int root;
+    int freeList;
+    int leafCount;
+    double margin, predict;
+    std::vector<int> moveBuffer;
+
+    int allocate();
+    void release(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refit(int node);
+    int balance(int node);
+    int rotate(int a, int up, int other);
+    AABB fatten(const AABB& box, const Vector3d& displacement) const;
+};
+
+#endif // DYNAMICAABBTREE_H
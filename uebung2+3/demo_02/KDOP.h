@@ -0,0 +1,94 @@
+#ifndef KDOP_H
+#define KDOP_H
+
+#include <vector>
+#include "vecmath.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// discrete oriented polytope with K/2 fixed slab directions,
+// K = 6 (AABB), 14 (+ space diagonals), 18 (+ face diagonals) or 26 (all).
+// Same interface as AABB: fit from points, merge, intersect.
+template<int K>
+class KDOP{
+    // direction() kennt nur diese K, fuer jedes andere bricht die
+    // Uebersetzung hier ab (negative Feldgroesse, ohne C++11)
+    typedef char supported_K[(K==6 || K==14 || K==18 || K==26) ? 1 : -1];
+
+public:
+    static const int N = K/2;
+
+    // Ausdehnung entlang direction(i)
+    double min[N], max[N];
+
+    KDOP(){
+        for(int i=0; i<N; i++){
+            min[i]=1e300;
+            max[i]=-1e300;
+        }
+    }
+
+    KDOP(const std::vector<Vector3d>& p){
+        for(int i=0; i<N; i++){
+            min[i]=1e300;
+            max[i]=-1e300;
+        }
+        for(unsigned int j=0; j<p.size(); j++){
+            add(p[j]);
+        }
+    }
+
+    // Richtung der i-ten Schicht (nicht normiert)
+    static Vector3d direction(int i){
+        static const double dir[13][3] = {
+            {1,0,0}, {0,1,0}, {0,0,1},
+            {1,1,1}, {1,1,-1}, {1,-1,1}, {1,-1,-1},
+            {1,1,0}, {1,-1,0}, {1,0,1}, {1,0,-1}, {0,1,1}, {0,1,-1}
+        };
+        // das 18-DOP ueberspringt die Raumdiagonalen
+        int k=(K==18 && i>=3) ? i+4 : i;
+        return Vector3d(dir[k][0], dir[k][1], dir[k][2]);
+    }
+
+    void add(const Vector3d& q){
+        for(int i=0; i<N; i++){
+            double t=q*direction(i);
+            if(t<min[i]) min[i]=t;
+            if(t>max[i]) max[i]=t;
+        }
+    }
+
+    void merge(const KDOP& B){
+        for(int i=0; i<N; i++){
+            if(B.min[i]<min[i]) min[i]=B.min[i];
+            if(B.max[i]>max[i]) max[i]=B.max[i];
+        }
+    }
+
+    // disjunkt, sobald sich die Intervalle in einer Richtung nicht ueberlappen
+    bool intersect(const KDOP& B) const{
+        int i=0;
+#ifdef __SSE2__
+        __m128d sep=_mm_setzero_pd();
+        for(; i+2<=N; i+=2){
+            __m128d c1=_mm_cmplt_pd(_mm_loadu_pd(max+i), _mm_loadu_pd(B.min+i));
+            __m128d c2=_mm_cmplt_pd(_mm_loadu_pd(B.max+i), _mm_loadu_pd(min+i));
+            sep=_mm_or_pd(sep, _mm_or_pd(c1,c2));
+        }
+        if(_mm_movemask_pd(sep)) return false;
+#endif
+        for(; i<N; i++){
+            if(max[i]<B.min[i] || B.max[i]<min[i]) return false;
+        }
+        return true;
+    }
+};
+
+typedef KDOP<6>  DOP6;
+typedef KDOP<14> DOP14;
+typedef KDOP<18> DOP18;
+typedef KDOP<26> DOP26;
+
+#endif // KDOP_H
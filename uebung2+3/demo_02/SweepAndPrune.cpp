@@ -0,0 +1,274 @@
+#include <algorithm>
+#include "SweepAndPrune.h"
+
+
+namespace {
+
+const long long EMPTY=-1;
+
+inline long long pairKey(int a, int b){
+    if(a>b) std::swap(a,b);
+    return ((long long)a<<32) | (unsigned int)b;
+}
+
+// Fibonacci hashing, the high bits of key*2^64/phi
+inline int pairHash(long long key){
+    return int(((unsigned long long)key*0x9E3779B97F4A7C15ULL)>>33);
+}
+
+inline double lower(const AABB& b, int axis){
+    return axis==0 ? b.xmin : axis==1 ? b.ymin : b.zmin;
+}
+
+inline double upper(const AABB& b, int axis){
+    return axis==0 ? b.xmax : axis==1 ? b.ymax : b.zmax;
+}
+
+}
+
+SweepAndPrune::SweepAndPrune() : swaps(0), count(0), keys(64,EMPTY), slots(64,0) {
+}
+
+int SweepAndPrune::add(const AABB& box){
+    int id;
+    if(!freeIds.empty()){
+        id=freeIds.back();
+        freeIds.pop_back();
+        proxies[id]=Proxy(box);
+    }else{
+        id=int(proxies.size());
+        proxies.push_back(Proxy(box));
+    }
+    count++;
+
+    //binary search for the place of the endpoints instead of sorting them
+    //in from one end, then a plain overlap test against every box
+    for(int a=0; a<3; a++){
+        std::vector<Endpoint>& e=axes[a];
+        int first=-1;
+        for(int m=0; m<2; m++){
+            Endpoint x;
+            x.value=m ? upper(box,a) : lower(box,a);
+            x.data=2*id+m;
+            int i=int(std::upper_bound(e.begin(),e.end(),x,less)-e.begin());
+            e.insert(e.begin()+i,x);
+            if(first<0) first=i;
+        }
+        reindex(a,first);
+    }
+    for(unsigned int other=0; other<proxies.size(); other++){
+        if(int(other)!=id && proxies[other].index[0][0]>=0 && box.intersect(proxies[other].box)){
+            addPair(id,other);
+        }
+    }
+    return id;
+}
+
+void SweepAndPrune::remove(int id){
+    for(int a=0; a<3; a++){
+        std::vector<Endpoint>& e=axes[a];
+        int* index=proxies[id].index[a];
+        e.erase(e.begin()+index[1]);
+        e.erase(e.begin()+index[0]);
+        reindex(a,index[0]);
+        index[0]=index[1]=-1;
+    }
+    //from the back, removePair moves the last pair forward
+    for(int k=int(pairList.size())-1; k>=0; k--){
+        if(pairList[k].first==id || pairList[k].second==id){
+            removePair(pairList[k].first,pairList[k].second);
+        }
+    }
+    freeIds.push_back(id);
+    count--;
+}
+
+void SweepAndPrune::build(const std::vector<AABB>& boxes){
+    int n=int(boxes.size());
+    proxies.clear();
+    freeIds.clear();
+    pairList.clear();
+    keys.assign(64,EMPTY);
+    slots.assign(64,0);
+    for(int i=0; i<n; i++) proxies.push_back(Proxy(boxes[i]));
+    count=n;
+
+    for(int a=0; a<3; a++){
+        std::vector<Endpoint>& e=axes[a];
+        e.resize(2*n);
+        for(int i=0; i<n; i++){
+            e[2*i].value=lower(boxes[i],a);
+            e[2*i].data=2*i;
+            e[2*i+1].value=upper(boxes[i],a);
+            e[2*i+1].data=2*i+1;
+        }
+        std::sort(e.begin(),e.end(),less);
+        reindex(a,0);
+    }
+
+    //one sweep along x: a box overlaps the boxes still open at its min
+    std::vector<int> open;
+    std::vector<int> openIndex(n,-1);
+    const std::vector<Endpoint>& e=axes[0];
+    for(int k=0; k<2*n; k++){
+        int id=e[k].data>>1;
+        if(e[k].data&1){
+            int i=openIndex[id];
+            open[i]=open.back();
+            openIndex[open[i]]=i;
+            open.pop_back();
+        }else{
+            for(unsigned int i=0; i<open.size(); i++){
+                if(boxes[id].intersect(boxes[open[i]])) addPair(id,open[i]);
+            }
+            openIndex[id]=int(open.size());
+            open.push_back(id);
+        }
+    }
+}
+
+void SweepAndPrune::update(int id, const AABB& box){
+    proxies[id].box=box;
+    setEndpoints(id);
+}
+
+void SweepAndPrune::reindex(int axis, int from){
+    const std::vector<Endpoint>& e=axes[axis];
+    for(int i=from; i<int(e.size()); i++){
+        proxies[e[i].data>>1].index[axis][e[i].data&1]=i;
+    }
+}
+
+bool SweepAndPrune::less(const Endpoint& a, const Endpoint& b){
+    //at equal values mins come first: touching boxes overlap, as in AABB::intersect
+    return a.value<b.value || (a.value==b.value && (a.data&1)<(b.data&1));
+}
+
+void SweepAndPrune::setEndpoints(int id){
+    const AABB& box=proxies[id].box;
+    for(int a=0; a<3; a++){
+        const int* index=proxies[id].index[a];
+        axes[a][index[0]].value=lower(box,a);
+        axes[a][index[1]].value=upper(box,a);
+        //in this order neither endpoint has to pass the other one of the box
+        siftDown(a,index[0]);
+        siftUp(a,index[1]);
+        siftDown(a,index[1]);
+        siftUp(a,index[0]);
+    }
+}
+
+void SweepAndPrune::siftDown(int axis, int i){
+    std::vector<Endpoint>& e=axes[axis];
+    Endpoint x=e[i];
+    int id=x.data>>1;
+    int isMax=x.data&1;
+    while(i>0 && less(x,e[i-1])){
+        Endpoint y=e[i-1];
+        int other=y.data>>1;
+        int otherMax=y.data&1;
+        if(!isMax && otherMax){
+            //our min passes the other max: overlap on this axis begins
+            if(proxies[id].box.intersect(proxies[other].box)) addPair(id,other);
+        }else if(isMax && !otherMax){
+            //our max passes the other min: overlap on this axis ends
+            removePair(id,other);
+        }
+        e[i]=y;
+        proxies[other].index[axis][otherMax]=i;
+        i--;
+        swaps++;
+    }
+    e[i]=x;
+    proxies[id].index[axis][isMax]=i;
+}
+
+void SweepAndPrune::siftUp(int axis, int i){
+    std::vector<Endpoint>& e=axes[axis];
+    int n=int(e.size());
+    Endpoint x=e[i];
+    int id=x.data>>1;
+    int isMax=x.data&1;
+    while(i+1<n && less(e[i+1],x)){
+        Endpoint y=e[i+1];
+        int other=y.data>>1;
+        int otherMax=y.data&1;
+        if(isMax && !otherMax){
+            if(proxies[id].box.intersect(proxies[other].box)) addPair(id,other);
+        }else if(!isMax && otherMax){
+            removePair(id,other);
+        }
+        e[i]=y;
+        proxies[other].index[axis][otherMax]=i;
+        i++;
+        swaps++;
+    }
+    e[i]=x;
+    proxies[id].index[axis][isMax]=i;
+}
+
+int SweepAndPrune::find(long long key) const{
+    int mask=int(keys.size())-1;
+    int h=pairHash(key)&mask;
+    while(keys[h]!=EMPTY && keys[h]!=key){
+        h=(h+1)&mask;
+    }
+    return h;
+}
+
+void SweepAndPrune::addPair(int a, int b){
+    long long key=pairKey(a,b);
+    int h=find(key);
+    if(keys[h]==key) return;
+    if(2*(pairList.size()+1)>keys.size()){
+        grow();
+        h=find(key);
+    }
+    keys[h]=key;
+    slots[h]=int(pairList.size());
+    pairList.push_back(std::make_pair(std::min(a,b),std::max(a,b)));
+}
+
+void SweepAndPrune::removePair(int a, int b){
+    long long key=pairKey(a,b);
+    int h=find(key);
+    if(keys[h]==EMPTY) return;
+
+    //the last pair of the list takes the place of the removed one
+    int k=slots[h];
+    std::pair<int,int> last=pairList.back();
+    pairList[k]=last;
+    slots[find(pairKey(last.first,last.second))]=k;
+    pairList.pop_back();
+
+    //backward shift deletion: later keys of the probe run move into the
+    //hole unless their home slot lies between the hole and them
+    int mask=int(keys.size())-1;
+    int j=h;
+    keys[j]=EMPTY;
+    for(int i=(j+1)&mask; keys[i]!=EMPTY; i=(i+1)&mask){
+        int home=pairHash(keys[i])&mask;
+        bool stays=j<i ? (home>j && home<=i) : (home>j || home<=i);
+        if(!stays){
+            keys[j]=keys[i];
+            slots[j]=slots[i];
+            keys[i]=EMPTY;
+            j=i;
+        }
+    }
+}
+
+void SweepAndPrune::grow(){
+    std::vector<long long> oldKeys;
+    std::vector<int> oldSlots;
+    oldKeys.swap(keys);
+    oldSlots.swap(slots);
+    keys.assign(2*oldKeys.size(),EMPTY);
+    slots.assign(keys.size(),0);
+    for(unsigned int i=0; i<oldKeys.size(); i++){
+        if(oldKeys[i]==EMPTY) continue;
+        int h=find(oldKeys[i]);
+        keys[h]=oldKeys[i];
+        slots[h]=oldSlots[i];
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef SWEEPANDPRUNE_H
+#define SWEEPANDPRUNE_H
+
+#include <vector>
+#include <utility>
+#include "BB.h"
+
+// Incremental sweep and prune broad phase: the min and max endpoints of
+// all boxes are kept sorted along x, y and z. A moved box is put back in
+// order by insertion sort, and every time a min passes a max of another
+// box their intervals on that axis start or stop overlapping. The set of
+// overlapping pairs is maintained from these swaps alone, so with coherent
+// motion an update costs a few swaps instead of a resort or an all-pairs
+// test.
+class SweepAndPrune{
+public:
+    SweepAndPrune();
+
+    // replace all boxes, box i gets id i; sorts once and finds the pairs
+    // in one sweep, much faster than adding the boxes one by one
+    void build(const std::vector<AABB>& boxes);
+    // insert a box, returns its id (ids of removed boxes are reused);
+    // add and remove are O(n)
+    int add(const AABB& box);
+    void remove(int id);
+    // new bounds of a box that moved
+    void update(int id, const AABB& box);
+
+    const AABB& box(int id) const { return proxies[id].box; }
+    // number of boxes
+    int size() const { return count; }
+
+    // overlapping boxes as id pairs with first<second, in no particular
+    // order; the same pair list gjkIntersectBatch in uebung6 takes
+    const std::vector<std::pair<int,int> >& pairs() const { return pairList; }
+
+    // endpoint swaps since construction
+    long long swaps;
+
+private:
+    struct Endpoint{
+        double value;
+        int data;   // 2*id, +1 for a max
+    };
+    struct Proxy{
+        AABB box;
+        // position of the min [0] and max [1] endpoint on each axis, -1 if free
+        int index[3][2];
+        Proxy(const AABB& b) : box(b) {}
+    };
+
+    std::vector<Endpoint> axes[3];
+    std::vector<Proxy> proxies;
+    std::vector<int> freeIds;
+    int count;
+
+    // pair -> position in pairList, open addressing with linear probing
+    std::vector<long long> keys;
+    std::vector<int> slots;
+    std::vector<std::pair<int,int> > pairList;
+
+    static bool less(const Endpoint& a, const Endpoint& b);
+    void reindex(int axis, int from);
+    void setEndpoints(int id);
+    void siftDown(int axis, int i);
+    void siftUp(int axis, int i);
+
+    int find(long long key) const;
+    void addPair(int a, int b);
+    void removePair(int a, int b);
+    void grow();
+};
+
+#endif // SWEEPANDPRUNE_H
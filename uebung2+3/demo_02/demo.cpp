@@ -8,22 +8,26 @@
 #include <QMessageBox>
 #include <QTextEdit>
 #include <QHBoxLayout>
+#include <QElapsedTimer>
 #include "demo.h"
 #include "BB.h"
+#include "SweepAndPrune.h"
+#include "DynamicAABBTree.h"
 
 #include <cmath>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <set>
+#include <string>
 
 #ifdef max
 #undef max
 #endif
 
-float angleX=0, angleY=0, angleZ=0;
-float xcoord=0, ycoord=0, zcoord=0;
-
 
 CGMainWindow::CGMainWindow (QWidget* parent, Qt::WindowFlags flags)
     : QMainWindow (parent, flags) {
@@ -138,6 +142,7 @@ void CGMainWindow::loadPolyhedron() {
                 ogl->P2[i][j]= ogl->P2[i][j]-ogl->centerOfMass2[j];
             }
         }
+        ogl->pose2=Pose();
     }
 
 
@@ -210,10 +215,7 @@ void CGView::drawMesh(){
             glPushMatrix();
             glColor3d(1,0,0);
             Vector3d n2;
-            glTranslatef(xcoord,ycoord,zcoord);
-            glRotatef(angleX, 1, 0, 0);
-            glRotatef(angleY, 0, 1, 0);
-            glRotatef(angleZ, 0, 0, 1);
+            glMultMatrixd(pose2.matrix().transpose().ptr());
 
             glBegin(GL_TRIANGLES);
             for(unsigned int i=0;i<ind2.size();i+=3) {
@@ -250,31 +252,21 @@ void CGView::drawOBB(std::vector<Vector3d> &p){
 
     glPushMatrix();
     glColor3d(1,0,0);
-    Matrix4d coordTrafo;
-        coordTrafo.print();
-    coordTrafo.makeIdentity();
-
-    coordTrafo.makeRotate(Vector3d(0,1,0), obbhuelle.axis1);
-    //coord.makeRotate(Vector3d(1,0,0), obbhuelle.axis2);
-
-//    Vector3d coordSys [6];
-//    coordSys[0]=coordTrafo*Vector3d(2,0,0);
-//    coordSys[1]=coordTrafo*Vector3d(-2,0,0);
-//    coordSys[2]=coordTrafo*Vector3d(0,2,0);
-//    coordSys[3]=coordTrafo*Vector3d(0,-2,0);
-//    coordSys[4]=coordTrafo*Vector3d(0,0,2);
-//    coordSys[5]=coordTrafo*Vector3d(0,0,-2);
-
-    // Vector3d v1=Vector3d()
+
+    Vector3d u=obbhuelle.axis1*obbhuelle.a1;
+    Vector3d v=obbhuelle.axis2*obbhuelle.a2;
+    Vector3d w=obbhuelle.axis3*obbhuelle.a3;
+    const Vector3d& c=obbhuelle.center;
+
     Vector3d boundingBox [8];
-    boundingBox[0]=coordTrafo*Vector3d(obbhuelle.a1,obbhuelle.a2,obbhuelle.a3);
-    boundingBox[1]=coordTrafo*Vector3d(obbhuelle.a1,obbhuelle.a2,-obbhuelle.a3);
-    boundingBox[2]=coordTrafo*Vector3d(obbhuelle.a1,-obbhuelle.a2,obbhuelle.a3);
-    boundingBox[3]=coordTrafo*Vector3d(obbhuelle.a1,-obbhuelle.a2,-obbhuelle.a3);
-    boundingBox[4]=coordTrafo*Vector3d(-obbhuelle.a1,obbhuelle.a2,obbhuelle.a3);
-    boundingBox[5]=coordTrafo*Vector3d(-obbhuelle.a1,obbhuelle.a2,-obbhuelle.a3);
-    boundingBox[6]=coordTrafo*Vector3d(-obbhuelle.a1,-obbhuelle.a2,obbhuelle.a3);
-    boundingBox[7]=coordTrafo*Vector3d(-obbhuelle.a1,-obbhuelle.a2,-obbhuelle.a3);
+    boundingBox[0]=c+u+v+w;
+    boundingBox[1]=c+u+v-w;
+    boundingBox[2]=c+u-v+w;
+    boundingBox[3]=c+u-v-w;
+    boundingBox[4]=c-u+v+w;
+    boundingBox[5]=c-u+v-w;
+    boundingBox[6]=c-u-v+w;
+    boundingBox[7]=c-u-v-w;
 
     glBegin(GL_LINE_LOOP);
     glColor3d(0, 1, 0);
@@ -383,59 +375,51 @@ void CGView::resizeGL(int width, int height) {
 
 void CGView::keyPressEvent( QKeyEvent * event) {
 
-    float dx,dy,dz;
-    dx = dy = dz = 0.01f;
+    // object 2 moves by its pose only, P2 stays in its local frame
+    double d = 0.01;
+    double angle = 2.0*M_PI/180.0;
 
     switch (event->key()) {
-    case Qt::Key_Q :{
-        xcoord+=dx;
-        update();
-        break;}
-    case Qt::Key_W :{
-        xcoord-=dx;
-        update();
-        break;}
-    case Qt::Key_A : {
-        ycoord+=dy;
-        update();
-        break;}
-    case Qt::Key_S : {
-        ycoord-=dy;
-        update();
-        break;}
-    case Qt::Key_Y : {
-        zcoord+=dz;
-        update();
-        break;}
+    case Qt::Key_Q :
+        pose2.translate(Vector3d( d,0,0));
+        break;
+    case Qt::Key_W :
+        pose2.translate(Vector3d(-d,0,0));
+        break;
+    case Qt::Key_A :
+        pose2.translate(Vector3d(0, d,0));
+        break;
+    case Qt::Key_S :
+        pose2.translate(Vector3d(0,-d,0));
+        break;
+    case Qt::Key_Y :
+        pose2.translate(Vector3d(0,0, d));
+        break;
     case Qt::Key_X :
-        zcoord-=dz;
-        update();
+        pose2.translate(Vector3d(0,0,-d));
         break;
     case Qt::Key_Up :
-        angleX-=2;
-        updateGL();
+        pose2.turn(-angle,Vector3d(1,0,0));
         break;
     case Qt::Key_Down :
-        angleX+=2;
-        updateGL();
+        pose2.turn( angle,Vector3d(1,0,0));
         break;
     case Qt::Key_Right :
-        angleY+=2;
-        updateGL();
+        pose2.turn( angle,Vector3d(0,1,0));
         break;
     case Qt::Key_Left :
-        angleY-=2;
-        updateGL();
+        pose2.turn(-angle,Vector3d(0,1,0));
         break;
     case Qt::Key_PageUp :
-        angleZ+=2;
-        updateGL();
+        pose2.turn( angle,Vector3d(0,0,1));
         break;
     case Qt::Key_PageDown :
-        angleZ-=2;
-        updateGL();
+        pose2.turn(-angle,Vector3d(0,0,1));
         break;
+    default:
+        return;
     }
+    updateGL();
 }
 
 
@@ -527,7 +511,405 @@ Quat4d CGView::trackball(const Vector3d& u, const Vector3d& v) {
 }
 
 
+static double uniform(double a, double b) {
+    return a+(b-a)*rand()/double(RAND_MAX);
+}
+
+static Vector3d randomDirection() {
+    Vector3d d(uniform(-1,1),uniform(-1,1),uniform(-1,1));
+    return d.lengthSquared()>1e-6 ? d : Vector3d(0,0,1);
+}
+
+// box with half extents h placed by pose: its OBB and AABB
+static void placeBox(const Pose& pose, const Vector3d& h, OBB& obb, Vector3d& lo, Vector3d& hi) {
+    obb.center=pose.t;
+    obb.axis1=pose.toWorld(Vector3d(1,0,0));
+    obb.axis2=pose.toWorld(Vector3d(0,1,0));
+    obb.axis3=pose.toWorld(Vector3d(0,0,1));
+    obb.a1=h[0]; obb.a2=h[1]; obb.a3=h[2];
+    for(int j=0; j<3; j++){
+        double r=fabs(obb.axis1[j])*h[0]+fabs(obb.axis2[j])*h[1]+fabs(obb.axis3[j])*h[2];
+        lo[j]=pose.t[j]-r;
+        hi[j]=pose.t[j]+r;
+    }
+}
+
+// all pairs of overlapping boxes by brute force, sorted
+static void allPairs(const SweepAndPrune& sap, const std::vector<int>& ids, std::vector<std::pair<int,int> >& pairs) {
+    pairs.clear();
+    for(unsigned int i=0; i<ids.size(); i++){
+        for(unsigned int j=i+1; j<ids.size(); j++){
+            if(sap.box(ids[i]).intersect(sap.box(ids[j]))){
+                pairs.push_back(std::make_pair(std::min(ids[i],ids[j]),std::max(ids[i],ids[j])));
+            }
+        }
+    }
+    std::sort(pairs.begin(),pairs.end());
+}
+
+static bool samePairs(const SweepAndPrune& sap, const std::vector<std::pair<int,int> >& reference) {
+    std::vector<std::pair<int,int> > p=sap.pairs();
+    std::sort(p.begin(),p.end());
+    return p==reference;
+}
+
+// boxes drifting and turning in a cube of edge L, the same for every call:
+// pose, half extents, motion per frame, and the current OBB and AABB
+struct BoxScene{
+    std::vector<Pose> poses;
+    std::vector<Vector3d> half, velocity, spin, lo, hi;
+    std::vector<OBB> obbs;
+};
+
+static void makeBoxScene(int n, double L, BoxScene& scene) {
+    srand(1);
+    scene.poses.assign(n,Pose());
+    scene.half.resize(n);
+    scene.velocity.resize(n);
+    scene.spin.resize(n);
+    scene.lo.resize(n);
+    scene.hi.resize(n);
+    scene.obbs.clear();
+    std::vector<Vector3d> unitCube;
+    for(int k=0; k<8; k++) unitCube.push_back(Vector3d(k&1 ? 1 : -1,k&2 ? 1 : -1,k&4 ? 1 : -1));
+    for(int i=0; i<n; i++){
+        scene.half[i]=Vector3d(uniform(0.25,1),uniform(0.25,1),uniform(0.25,1));
+        scene.poses[i].translate(Vector3d(uniform(0,L),uniform(0,L),uniform(0,L)));
+        scene.poses[i].turn(uniform(0,2*M_PI),randomDirection());
+        scene.velocity[i]=Vector3d(uniform(-0.1,0.1),uniform(-0.1,0.1),uniform(-0.1,0.1));
+        scene.spin[i]=randomDirection();
+        scene.obbs.push_back(OBB(unitCube));
+        placeBox(scene.poses[i],scene.half[i],scene.obbs[i],scene.lo[i],scene.hi[i]);
+    }
+}
+
+// one frame of box i: move and turn it, bounce off the walls, update its
+// OBB and AABB; returns the displacement
+static Vector3d stepBox(BoxScene& scene, int i, double L) {
+    Pose& pose=scene.poses[i];
+    Vector3d before=pose.t;
+    pose.translate(scene.velocity[i]);
+    pose.turn(0.02,scene.spin[i]);
+    for(int k=0; k<3; k++){
+        if(pose.t[k]<0 || pose.t[k]>L) scene.velocity[i][k]=-scene.velocity[i][k];
+    }
+    placeBox(pose,scene.half[i],scene.obbs[i],scene.lo[i],scene.hi[i]);
+    return pose.t-before;
+}
+
+// 10000 boxes drifting and turning in a cube of edge 100 for 100 frames:
+// incremental sweep and prune against testing all pairs, and the OBB test
+// on the pairs it reports
+static void benchmarkSAP() {
+    const int N=10000, FRAMES=100;
+    const double L=100.0;
+    BoxScene scene;
+    makeBoxScene(N,L,scene);
+    std::vector<Vector3d>& half=scene.half;
+    std::vector<Vector3d>& lo=scene.lo;
+    std::vector<Vector3d>& hi=scene.hi;
+    std::vector<OBB>& obbs=scene.obbs;
+
+    SweepAndPrune sap;
+    std::vector<AABB> bounds;
+    for(int i=0; i<N; i++) bounds.push_back(AABB(lo[i],hi[i]));
+    QElapsedTimer timer;
+    timer.start();
+    sap.build(bounds);
+    qint64 buildNs=timer.nsecsElapsed();
+    std::cout << "sweep and prune, " << N << " boxes: build " << buildNs/1e6 << " ms, "
+              << sap.pairs().size() << " pairs, " << sap.swaps << " swaps" << std::endl;
+
+    qint64 updateNs=0, narrowNs=0;
+    long long swaps0=sap.swaps, pairs=0, hits=0;
+    for(int f=0; f<FRAMES; f++){
+        for(int i=0; i<N; i++) stepBox(scene,i,L);
+        timer.restart();
+        for(int i=0; i<N; i++) sap.update(i,AABB(lo[i],hi[i]));
+        updateNs+=timer.nsecsElapsed();
+
+        const std::vector<std::pair<int,int> >& p=sap.pairs();
+        timer.restart();
+        for(unsigned int k=0; k<p.size(); k++){
+            hits+=obbs[p[k].first].intersect(obbs[p[k].second]);
+        }
+        narrowNs+=timer.nsecsElapsed();
+        pairs+=p.size();
+    }
+    std::cout << "per frame: update " << updateNs/1e6/FRAMES << " ms, " << double(sap.swaps-swaps0)/FRAMES
+              << " swaps, " << double(pairs)/FRAMES << " pairs, " << double(hits)/FRAMES << " OBBs intersect ("
+              << narrowNs/1e6/FRAMES << " ms)" << std::endl;
+
+    std::vector<int> ids(N);
+    for(int i=0; i<N; i++) ids[i]=i;
+    std::vector<std::pair<int,int> > reference;
+    timer.restart();
+    allPairs(sap,ids,reference);
+    qint64 bruteNs=timer.nsecsElapsed();
+    std::cout << "all pairs: " << bruteNs/1e6 << " ms, same pairs: " << (samePairs(sap,reference) ? "yes" : "NO") << std::endl;
+
+    //remove every 10th box, add as many new ones
+    timer.restart();
+    for(int i=0; i<N; i+=10) sap.remove(i);
+    ids.clear();
+    for(int i=0; i<N; i++){
+        if(i%10) ids.push_back(i);
+    }
+    for(int i=0; i<N; i+=10){
+        Vector3d c(uniform(0,L),uniform(0,L),uniform(0,L));
+        ids.push_back(sap.add(AABB(c-half[i],c+half[i])));
+    }
+    qint64 churnNs=timer.nsecsElapsed();
+    allPairs(sap,ids,reference);
+    std::cout << "remove and add " << N/10 << " boxes: " << churnNs/1e6 << " ms, same pairs: "
+              << (samePairs(sap,reference) ? "yes" : "NO") << std::endl;
+}
+
+// overlapping fat boxes kept across frames, every pair in both orders so
+// that the pairs of one proxy are a contiguous range
+typedef std::set<std::pair<int,int> > PairSet;
+
+// forgets all pairs of the given proxies
+static void dropPairs(PairSet& pairs, const std::vector<int>& ids) {
+    for(unsigned int i=0; i<ids.size(); i++){
+        PairSet::iterator it=pairs.lower_bound(std::make_pair(ids[i],-1));
+        while(it!=pairs.end() && it->first==ids[i]){
+            pairs.erase(std::make_pair(it->second,it->first));
+            pairs.erase(it++);
+        }
+    }
+}
+
+// movedPairs reports every pair of a reinserted proxy again, and the fat
+// boxes of the other proxies have not changed: drop the old pairs of the
+// moved proxies and add the new ones, the rest stays untouched
+static void updatePairs(PairSet& pairs, const std::vector<std::pair<int,int> >& moved, const std::vector<int>& movedIds) {
+    dropPairs(pairs,movedIds);
+    for(unsigned int k=0; k<moved.size(); k++){
+        pairs.insert(moved[k]);
+        pairs.insert(std::make_pair(moved[k].second,moved[k].first));
+    }
+}
+
+// each pair of the set once with first<second, sorted
+static std::vector<std::pair<int,int> > pairList(const PairSet& pairs) {
+    std::vector<std::pair<int,int> > list;
+    for(PairSet::const_iterator it=pairs.begin(); it!=pairs.end(); ++it){
+        if(it->first<it->second) list.push_back(*it);
+    }
+    return list;
+}
+
+// overlapping fat boxes by brute force, sorted
+static std::vector<std::pair<int,int> > fatPairs(const DynamicAABBTree& tree, const std::vector<int>& proxy) {
+    std::vector<std::pair<int,int> > pairs;
+    for(unsigned int i=0; i<proxy.size(); i++){
+        for(unsigned int j=i+1; j<proxy.size(); j++){
+            if(tree.testOverlap(proxy[i],proxy[j])){
+                pairs.push_back(std::make_pair(std::min(proxy[i],proxy[j]),std::max(proxy[i],proxy[j])));
+            }
+        }
+    }
+    std::sort(pairs.begin(),pairs.end());
+    return pairs;
+}
+
+// the 10000 boxes of benchmarkSAP in a dynamic AABB tree: all of them
+// moving, then only 1% of them, where a frame costs about as much as the
+// reinserted boxes and not the number of boxes or cached pairs; pair and
+// ray queries checked against brute force on the fat boxes
+static void benchmarkTree() {
+    const int N=10000, FRAMES=100;
+    const double L=100.0;
+    BoxScene scene;
+    makeBoxScene(N,L,scene);
+    std::vector<Vector3d>& half=scene.half;
+    std::vector<Vector3d>& lo=scene.lo;
+    std::vector<Vector3d>& hi=scene.hi;
+
+    DynamicAABBTree tree;
+    std::vector<int> proxy(N);
+    PairSet pairs;
+    std::vector<std::pair<int,int> > moved;
+    std::vector<int> movedIds;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i=0; i<N; i++) proxy[i]=tree.add(AABB(lo[i],hi[i]));
+    tree.movedPairs(moved,&movedIds);
+    updatePairs(pairs,moved,movedIds);
+    qint64 buildNs=timer.nsecsElapsed();
+    std::cout << "dynamic AABB tree, " << N << " boxes: insert " << buildNs/1e6 << " ms, height " << tree.height()
+              << ", area ratio " << tree.areaRatio() << ", " << pairs.size()/2 << " fat pairs" << std::endl;
+
+    for(int pass=0; pass<2; pass++){
+        int step=pass==0 ? 1 : 100;
+        qint64 ns=0;
+        long long reinserted=0, pairCount=0;
+        for(int f=0; f<FRAMES; f++){
+            timer.restart();
+            for(int i=f%step; i<N; i+=step){
+                Vector3d displacement=stepBox(scene,i,L);
+                reinserted+=tree.move(proxy[i],AABB(lo[i],hi[i]),displacement);
+            }
+            tree.movedPairs(moved,&movedIds);
+            updatePairs(pairs,moved,movedIds);
+            ns+=timer.nsecsElapsed();
+            pairCount+=pairs.size()/2;
+        }
+        std::cout << (pass==0 ? "all" : "1% of the") << " boxes moving, per frame: " << ns/1e6/FRAMES << " ms, "
+                  << double(reinserted)/FRAMES << " reinserted, " << double(pairCount)/FRAMES << " fat pairs; height "
+                  << tree.height() << ", area ratio " << tree.areaRatio() << std::endl;
+    }
+
+    std::vector<std::pair<int,int> > all;
+    tree.allPairs(all);
+    std::sort(all.begin(),all.end());
+    std::cout << "pairs kept up to date: " << (pairList(pairs)==fatPairs(tree,proxy) ? "yes" : "NO")
+              << ", all pairs query: " << (all==fatPairs(tree,proxy) ? "yes" : "NO") << std::endl;
+
+    int wrong=0;
+    long long hitCount=0;
+    qint64 rayNs=0;
+    std::vector<std::pair<double,int> > hits;
+    for(int r=0; r<1000; r++){
+        Vector3d from(uniform(0,L),uniform(0,L),uniform(0,L));
+        Vector3d to(uniform(0,L),uniform(0,L),uniform(0,L));
+        timer.restart();
+        tree.rayCast(from,to,hits);
+        rayNs+=timer.nsecsElapsed();
+        hitCount+=hits.size();
+        std::vector<int> found, reference;
+        for(unsigned int k=0; k<hits.size(); k++) found.push_back(hits[k].second);
+        for(int i=0; i<N; i++){
+            double t;
+            if(tree.fatBox(proxy[i]).intersectSegment(from,to,t)) reference.push_back(proxy[i]);
+        }
+        std::sort(found.begin(),found.end());
+        std::sort(reference.begin(),reference.end());
+        wrong+=found!=reference;
+    }
+    std::cout << "1000 random segments: " << double(hitCount)/1000 << " hits, "
+              << rayNs/1e3/1000 << " us each, " << wrong << " different from testing every box" << std::endl;
+
+    //remove every 10th box, add as many new ones; pairs of removed proxies
+    //are dropped by hand, their ids come back
+    timer.restart();
+    std::vector<int> removed;
+    for(int i=0; i<N; i+=10){
+        tree.remove(proxy[i]);
+        removed.push_back(proxy[i]);
+    }
+    dropPairs(pairs,removed);
+    for(int i=0; i<N; i+=10){
+        Vector3d c(uniform(0,L),uniform(0,L),uniform(0,L));
+        proxy[i]=tree.add(AABB(c-half[i],c+half[i]));
+    }
+    tree.movedPairs(moved,&movedIds);
+    updatePairs(pairs,moved,movedIds);
+    qint64 churnNs=timer.nsecsElapsed();
+    std::cout << "remove and add " << N/10 << " boxes: " << churnNs/1e6 << " ms, height " << tree.height()
+              << ", pairs kept up to date: " << (pairList(pairs)==fatPairs(tree,proxy) ? "yes" : "NO") << std::endl;
+}
+
+// OBB fitting modes compared on one point set: fit time vs. box volume,
+// on all points and on their convex hull (including the time to build it),
+// and the capsule fit against the boxes
+static void compareOBB(const std::vector<Vector3d>& points) {
+    const char* modeName[3]={"PCA", "DiTO", "calipers (approximate)"};
+    for(int m=0; m<3; m++){
+        QElapsedTimer timer;
+        timer.start();
+        OBB box(points, OBB::FitMode(m));
+        qint64 ns=timer.nsecsElapsed();
+        std::cout << "OBB " << modeName[m] << ": volume " << box.volume()
+                  << ", fit time " << ns/1000.0 << " us" << std::endl;
+    }
+
+    AABB aabb(points);
+    QElapsedTimer capsuleTimer;
+    capsuleTimer.start();
+    Capsule capsule(points);
+    qint64 capsuleNs=capsuleTimer.nsecsElapsed();
+    int outside=0;
+    for(unsigned int i=0; i<points.size(); i++){
+        double r=capsule.radius*(1+1e-9);
+        if(Capsule::segmentDistanceSquared(points[i],points[i],capsule.p0,capsule.p1)>r*r) outside++;
+    }
+    std::cout << "AABB: volume " << (aabb.xmax-aabb.xmin)*(aabb.ymax-aabb.ymin)*(aabb.zmax-aabb.zmin) << "; capsule: volume " << capsule.volume()
+              << ", radius " << capsule.radius << ", length " << (capsule.p1-capsule.p0).length()
+              << ", fit time " << capsuleNs/1000.0 << " us, " << outside << " points outside" << std::endl;
+
+    QElapsedTimer hullTimer;
+    hullTimer.start();
+    ConvexHull hull(points);
+    qint64 hullNs=hullTimer.nsecsElapsed();
+    std::cout << "convex hull: " << hull.nr_of_vertices() << " of " << points.size()
+              << " vertices, " << hullNs/1000.0 << " us" << std::endl;
+    for(int m=0; m<3; m++){
+        QElapsedTimer timer;
+        timer.start();
+        OBB box(hull, OBB::FitMode(m));
+        qint64 ns=timer.nsecsElapsed();
+        std::cout << "OBB " << modeName[m] << " on hull: volume " << box.volume()
+                  << ", fit time " << ns/1000.0 << " us" << std::endl;
+    }
+}
+
+// the vertices of an OFF file, or without a file three random clouds: points
+// in a flat box, in an elongated ellipsoid and in a long cylinder, all turned
+// arbitrarily
+static void benchmarkOBB(const char* filename) {
+    if (filename) {
+        std::ifstream file(filename);
+        std::string s;
+        int vn=0, fn, en;
+        file >> s >> vn >> fn >> en;
+        std::vector<Vector3d> points(vn);
+        for(int i=0; i<vn; i++) file >> points[i][0] >> points[i][1] >> points[i][2];
+        if (!file) {
+            std::cout << "cannot read " << filename << std::endl;
+            return;
+        }
+        std::cout << filename << ", " << vn << " vertices" << std::endl;
+        compareOBB(points);
+        return;
+    }
+
+    srand(1);
+    const int N=100000;
+    Pose pose;
+    pose.turn(uniform(0,2*M_PI),randomDirection());
+    std::vector<Vector3d> box(N), ellipsoid(N), cylinder(N);
+    for(int i=0; i<N; i++){
+        box[i]=pose.apply(Vector3d(uniform(-4,4),uniform(-1,1),uniform(-0.2,0.2)));
+        Vector3d d;
+        do d=Vector3d(uniform(-1,1),uniform(-1,1),uniform(-1,1)); while(d.lengthSquared()>1);
+        ellipsoid[i]=pose.apply(Vector3d(4*d[0],2*d[1],d[2]));
+        double a=uniform(0,2*M_PI), r=sqrt(uniform(0,1));
+        cylinder[i]=pose.apply(Vector3d(r*cos(a),r*sin(a),uniform(-5,5)));
+    }
+    std::cout << N << " points in a box 8 x 2 x 0.4 (volume 6.4)" << std::endl;
+    compareOBB(box);
+    std::cout << N << " points in an ellipsoid 4 x 2 x 1 (box volume 64)" << std::endl;
+    compareOBB(ellipsoid);
+    std::cout << N << " points in a cylinder of radius 1 and length 10 (volume 31.4, capsule 35.6)" << std::endl;
+    compareOBB(cylinder);
+}
+
 int main (int argc, char **argv) {
+    if (argc >= 2 && std::string(argv[1]) == "-obb") {
+        benchmarkOBB(argc >= 3 ? argv[2] : NULL);
+        return 0;
+    }
+    if (argc == 2 && std::string(argv[1]) == "-sap") {
+        benchmarkSAP();
+        return 0;
+    }
+    if (argc == 2 && std::string(argv[1]) == "-tree") {
+        benchmarkTree();
+        return 0;
+    }
+
     QApplication app(argc, argv);
 
     if (!QGLFormat::hasOpenGL()) {
@@ -20,6 +20,7 @@
 
 
 #include "vecmath.h"
+#include "Pose.h"
 
 class CGView;
 
@@ -67,6 +68,7 @@ public:
     std::vector<int> ind1, ind2;   // the faces of the loaded model,
 				// ind[i] ind[i+1] ind[i+2] 
 				// contains the indices of the i-th triangle
+    Pose pose2;  // placement of the second model, P2 stays in its local frame
     Quat4d q_now;
 
 
@@ -7,13 +7,17 @@
 #include <QKeyEvent>
 #include <QMessageBox>
 #include <QHBoxLayout>
+#include <QElapsedTimer>
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <limits>
+#include <string>
 
 #include "SES.h"
 #include "Sphere.h"
@@ -349,7 +353,121 @@ void CGView::keyPressEvent( QKeyEvent * event)
 
     updateGL();
 }
+// alter Weg ueber Matrix4d::inverse, Referenz fuer Sphere::circumcenter
+static Vector3d circumcenterMatrix(const Vector3d& a, const Vector3d& b, const Vector3d& c) {
+    Vector3d ba = b-a, ca = c-a, n = ba%ca;
+    Matrix4d T(ba[0],ba[1],ba[2],0.0,
+               ca[0],ca[1],ca[2],0.0,
+               n[0], n[1], n[2], 0.0,
+               0.0,  0.0,  0.0,  1.0);
+    Vector3d r(0.5*ba.lengthSquared(),0.5*ca.lengthSquared(),0.0);
+    return Matrix4d::inverse(T)*r + a;
+}
+
+static Vector3d circumcenterMatrix(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d) {
+    Vector3d ba = b-a, ca = c-a, da = d-a;
+    Matrix4d T(ba[0],ba[1],ba[2],0.0,
+               ca[0],ca[1],ca[2],0.0,
+               da[0],da[1],da[2],0.0,
+               0.0,  0.0,  0.0,  1.0);
+    Vector3d r(0.5*ba.lengthSquared(),0.5*ca.lengthSquared(),0.5*da.lengthSquared());
+    return Matrix4d::inverse(T)*r + a;
+}
+
+static double uniform(double a, double b) {
+    return a+(b-a)*rand()/double(RAND_MAX);
+}
+
+static Vector3d randomPoint() {
+    return Vector3d(uniform(-1,1),uniform(-1,1),uniform(-1,1));
+}
+
+// groesste Abweichung |m-p_j|-r relativ zu r ueber die k Punkte
+static double circumResidual(const Vector3d& m, const Vector3d* q, int k) {
+    double r = (m-q[0]).length();
+    double res = 0.0;
+    for(int j=1;j<k;j++)
+        res = std::max(res,fabs((m-q[j]).length()-r)/r);
+    return res;
+}
+
+// nimmt die Ergebnisse der Zeitmessung auf, damit der Compiler die Schleifen nicht streicht
+static volatile double circum_sink;
+
+// Sphere::circumcenter gegen den alten Weg ueber Matrix4d::inverse, auf
+// zufaelligen Dreiecken/Tetraedern und solchen, deren letzter Punkt bis auf
+// eps auf der Geraden/Ebene der anderen liegt: als entartet erkannte Faelle,
+// Abstand der beiden Mittelpunkte und Abweichung vom Umkugelradius (jeweils
+// relativ zum Radius) sowie Zeit pro Aufruf
+static void printCircumcenterCheck() {
+    const int N = 100000;
+    const double eps[5] = {0.0,1e-3,1e-6,1e-9,1e-12};
+    srand(1);
+    for(int k=3;k<=4;k++) {
+        for(int e=0;e<5;e++) {
+            std::vector<Vector3d> p(k*N);
+            for(int i=0;i<N;i++) {
+                Vector3d* q = &p[k*i];
+                for(int j=0;j<k;j++)
+                    q[j] = randomPoint();
+                if (e == 0) continue;
+                Vector3d on = q[0] + (q[1]-q[0])*uniform(0,1);
+                if (k == 4)
+                    on += (q[2]-q[0])*uniform(0,1);
+                q[k-1] = on + randomPoint()*eps[e];
+            }
+
+            int degenerate = 0;
+            double diff = 0.0, res_new = 0.0, res_old = 0.0;
+            for(int i=0;i<N;i++) {
+                const Vector3d* q = &p[k*i];
+                Vector3d m;
+                bool ok = k == 3 ? Sphere::circumcenter(q[0],q[1],q[2],m) : Sphere::circumcenter(q[0],q[1],q[2],q[3],m);
+                if (!ok) {
+                    degenerate++;
+                    continue;
+                }
+                Vector3d ref = k == 3 ? circumcenterMatrix(q[0],q[1],q[2]) : circumcenterMatrix(q[0],q[1],q[2],q[3]);
+                diff = std::max(diff,(m-ref).length()/(m-q[0]).length());
+                res_new = std::max(res_new,circumResidual(m,q,k));
+                res_old = std::max(res_old,circumResidual(ref,q,k));
+            }
+
+            QElapsedTimer timer;
+            double sum = 0.0;
+            timer.start();
+            for(int i=0;i<N;i++) {
+                const Vector3d* q = &p[k*i];
+                Vector3d m;
+                if (k == 3) Sphere::circumcenter(q[0],q[1],q[2],m);
+                else Sphere::circumcenter(q[0],q[1],q[2],q[3],m);
+                sum += m[0];
+            }
+            double ns_new = double(timer.nsecsElapsed())/N;
+            timer.restart();
+            for(int i=0;i<N;i++) {
+                const Vector3d* q = &p[k*i];
+                sum += k == 3 ? circumcenterMatrix(q[0],q[1],q[2])[0] : circumcenterMatrix(q[0],q[1],q[2],q[3])[0];
+            }
+            double ns_old = double(timer.nsecsElapsed())/N;
+            circum_sink = sum;
+
+            std::cout << (k == 3 ? "triangles " : "tetrahedra ");
+            if (e == 0) std::cout << "random"; else std::cout << "eps " << eps[e];
+            std::cout << ": degenerate " << degenerate << "/" << N
+              << ", center diff " << diff << ", residual " << res_new << " (matrix " << res_old << ")"
+              << ", " << ns_new << " ns/call (matrix " << ns_old << ")" << std::endl;
+        }
+    }
+}
+
+
 int main (int argc, char **argv) {
+    if (argc == 2 && std::string(argv[1]) == "-circum") {
+        printCircumcenterCheck();
+        return 0;
+    }
+
     QApplication app(argc, argv);
 
     if (!QGLFormat::hasOpenGL()) {
@@ -2,6 +2,8 @@
 #include "Sphere.h"
 #include <iostream>
 
+const double Sphere::DEGENERATE_EPS = 1e-12;
+
 Sphere::Sphere() {
     center = Vector3d(0.0,0.0,0.0);
     radius = 0.0;
@@ -23,46 +25,85 @@ Sphere::Sphere(Vector3d& a, Vector3d& b) {
 
 }
 
-// Konstruiere die Umkugel fuer drei Punkte
-Sphere::Sphere(Vector3d& a, Vector3d& b, Vector3d& c) {
+// Umkreismittelpunkt des Dreiecks abc in geschlossener Form:
+// m = a + ((c-a)|b-a|^2 - (b-a)|c-a|^2) x n / (2|n|^2) mit n = (b-a) x (c-a).
+// |n|^2 direkt aus dem Kreuzprodukt ist auch fast kollinear genau, anders
+// als die Gram-Determinante |b-a|^2|c-a|^2 - ((b-a)*(c-a))^2.
+// Liefert false, falls a,b,c (numerisch) kollinear sind.
+bool Sphere::circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, Vector3d& m) {
+
+    Vector3d u=b-a;
+    Vector3d v=c-a;
+    double uu=u*u, vv=v*v;
+
+    Vector3d n=u%v;
+    double D=n*n;
+    if(D<=DEGENERATE_EPS*uu*vv){
+        return false;
+    }
 
-    //Berechne dritte Ebene: Dreiecksebene
-    Matrix4d triangle = Matrix4d(a[0], a[1], a[2], 0, b[1], b[1], b[2], 0, c[0], c[1], c[2], 0, 0,0,0,1 );
-    Matrix4d triangle2;
-    triangle2.invert(triangle);
-    Vector3d coeffTri=triangle2*Vector3d(1,1,1);
+    m=a+((v*uu-u*vv)%n)/(2.0*D);
+    return true;
+}
 
-    Vector3d x=b-a;
-    Vector3d y=c-a;
-    Matrix4d coeff=Matrix4d(x[0],x[1],x[2],0,y[0],y[1],y[2],0,coeffTri[0],coeffTri[1],coeffTri[2],0,0,0,0,1);
+// Umkugelmittelpunkt des Tetraeders abcd in geschlossener Form (Cramersche Regel).
+// Liefert false, falls a,b,c,d (numerisch) koplanar sind.
+bool Sphere::circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, Vector3d& m) {
 
-    Matrix4d coeffInv;
-    coeffInv.invert(coeff);
+    Vector3d u=b-a;
+    Vector3d v=c-a;
+    Vector3d w=d-a;
+    double uu=u*u, vv=v*v, ww=w*w;
 
-    Vector3d centerCoord= coeffInv*Vector3d(b*b-a*a, c*c-a*a, 2)*0.5;
-    center=Vector3d(centerCoord[0],centerCoord[1],centerCoord[2]);
+    Vector3d vxw=v%w;
+    double D=u*vxw;
+    if(D*D<=DEGENERATE_EPS*uu*vv*ww){
+        return false;
+    }
 
-    radius=(center-a).length();
+    m=a+(vxw*uu+(w%u)*vv+(u%v)*ww)/(2.0*D);
+    return true;
+}
 
+// Konstruiere die Umkugel fuer drei Punkte
+Sphere::Sphere(Vector3d& a, Vector3d& b, Vector3d& c) {
+
+    if(circumcenter(a,b,c,center)){
+        radius=(center-a).length();
+        return;
+    }
+
+    //Entartet (kollinear): die beiden entferntesten Punkte bilden den Durchmesser
+    double ab=(b-a).lengthSquared();
+    double bc=(c-b).lengthSquared();
+    double ca=(a-c).lengthSquared();
+    if(ab>=bc && ab>=ca) *this=Sphere(a,b);
+    else if(bc>=ca)      *this=Sphere(b,c);
+    else                 *this=Sphere(c,a);
 }
 
 // Konstruiere die Umkugel fuer vier Punkte
 Sphere::Sphere(Vector3d& a, Vector3d& b, Vector3d& c, Vector3d& d) {
 
-    Vector3d x=b-a;
-    Vector3d y=c-a;
-    Vector3d z=d-a;
-    Matrix4d coeff=Matrix4d(x[0],x[1],x[2],0,y[0],y[1],y[2],0,z[0],z[1],z[2],0,0,0,0,1);
-
-    Matrix4d coeffInv;
-    coeffInv.invert(coeff);
-
-    Vector3d centerCoord= coeffInv*Vector3d(b*b-a*a, c*c-a*a, d*d-a*a)*0.5;
-    center=Vector3d(centerCoord[0],centerCoord[1],centerCoord[2]);
+    if(circumcenter(a,b,c,d,center)){
+        radius=(center-a).length();
+        return;
+    }
 
-    //Vector3d n=;
-    radius=(center-a).length();
+    //Entartet (koplanar): kleinste Dreiecks-Umkugel, die alle vier Punkte enthaelt
+    Sphere S[4]={Sphere(a,b,c), Sphere(a,b,d), Sphere(a,c,d), Sphere(b,c,d)};
+    Vector3d* q[4]={&a,&b,&c,&d};
+    int best=-1, largest=0;
+    for(int i=0; i<4; i++){
+        if(S[i].radius>S[largest].radius) largest=i;
 
+        bool contains=true;
+        for(int j=0; j<4 && contains; j++){
+            contains=(*q[j]-S[i].center).length()<=S[i].radius*(1.0+1e-9);
+        }
+        if(contains && (best<0 || S[i].radius<S[best].radius)) best=i;
+    }
+    *this=S[best<0 ? largest : best];
 }
 
 bool Sphere::isPointInSphere(const Vector3d p, Sphere sphere){
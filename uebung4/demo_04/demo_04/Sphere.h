@@ -7,6 +7,10 @@
 class Sphere {
   public:
 
+  // relative Schranke (sin^2 des Winkels bzw. normiertes Volumen^2),
+  // unterhalb der drei/vier Punkte als entartet gelten
+  static const double DEGENERATE_EPS;
+
   Vector3d center;
   double radius;
 
@@ -30,6 +34,12 @@ class Sphere {
   // Berechne den Schwerpunkt der Punktmenge
   static Sphere com(const std::vector<Vector3d>& p);
 
+  // Umkreismittelpunkt m von a,b,c; false falls die Punkte kollinear sind
+  static bool circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, Vector3d& m);
+
+  // Umkugelmittelpunkt m von a,b,c,d; false falls die Punkte koplanar sind
+  static bool circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, Vector3d& m);
+
   private:
 
   bool isPointInSphere(const Vector3d p, Sphere sphere);
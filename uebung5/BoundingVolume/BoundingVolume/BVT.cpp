@@ -1,70 +1,1171 @@
 #include "BVT.h"
 
 #include "Sphere.h"
+#include "SphereBatch.h"
+#include "BVTFile.h"
 
+#include <algorithm>
 #include <iostream>
+#include <queue>
+#include <functional>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define maximal_points 10
+#define task_points 32768
 using namespace std;
 
+namespace {
+
+/// true for points on the negative side of the plane (x-c)^T*v = 0
+struct BelowPlane
+{
+	const std::vector<Vector3d>& p;
+	Vector3d c, v;
+	BelowPlane (const std::vector<Vector3d>& p_, const Vector3d& c_, const Vector3d& v_) : p (p_), c (c_), v (v_) {}
+	bool operator () (int i) const {return (p[i]-c)*v < 0.0;}
+};
+
+/// orders point indices along coordinate k
+struct AlongCoordinate
+{
+	const std::vector<Vector3d>& p;
+	int k;
+	AlongCoordinate (const std::vector<Vector3d>& p_, int k_) : p (p_), k (k_) {}
+	bool operator () (int a, int b) const {return p[a][k] < p[b][k];}
+};
+
+/// orders point indices along v
+struct AlongAxis
+{
+	const std::vector<Vector3d>& p;
+	Vector3d v;
+	AlongAxis (const std::vector<Vector3d>& p_, const Vector3d& v_) : p (p_), v (v_) {}
+	bool operator () (int a, int b) const {return p[a]*v < p[b]*v;}
+};
+
+/** Die Reduktionen ueber die Punkte eines Knotens haben alle die Form
+		add (Punkt) und merge (Teilergebnis), damit reduce () sie an den grossen
+		Knoten in Tasks zerlegen kann. */
+
+/// Summe der Punkte (Schwerpunkt)
+struct Sum
+{
+	Vector3d s;
+	void add (const Vector3d& x) {s += x;}
+	void merge (const Sum& o) {s += o.s;}
+};
+
+/// Traegheitsmatrix um c, nur die sechs verschiedenen Eintraege
+struct Inertia
+{
+	Vector3d c;
+	double m[6];
+	Inertia (const Vector3d& c_) : c (c_) {for(int j=0;j<6;j++) m[j] = 0.0;}
+	void add (const Vector3d& x) {
+		Vector3d r = x-c;
+		m[0] += r[1]*r[1]+r[2]*r[2];
+		m[1] += r[0]*r[0]+r[2]*r[2];
+		m[2] += r[0]*r[0]+r[1]*r[1];
+		m[3] -= r[0]*r[1];
+		m[4] -= r[0]*r[2];
+		m[5] -= r[1]*r[2];
+	}
+	void merge (const Inertia& o) {for(int j=0;j<6;j++) m[j] += o.m[j];}
+};
+
+/// achsenparallele Box, nur fuer die Bau-Heuristiken
+struct Bounds
+{
+	Vector3d lo, hi;
+	Bounds () : lo (1e300), hi (-1e300) {}
+	bool empty () const {return lo[0] > hi[0];}
+	void add (const Vector3d& x) {for(int k=0;k<3;k++) {lo[k] = std::min (lo[k],x[k]); hi[k] = std::max (hi[k],x[k]);}}
+	void merge (const Bounds& b) {if (!b.empty ()) {add (b.lo); add (b.hi);}}
+	/// Oberflaeche der umschliessenden Kugel ~ Diagonale^2
+	double area () const {return empty () ? 0.0 : (hi-lo).lengthSquared ();}
+};
+
+/// SAH-Bins fuer alle drei Koordinatenachsen in einem Durchlauf
+struct Bins
+{
+	enum {N = 16};
+	Vector3d lo, scale;
+	Bounds box[3][N];
+	int n[3][N];
+	Bins (const Bounds& all) : lo (all.lo) {
+		for(int k=0;k<3;k++) {
+			double extent = all.hi[k]-all.lo[k];
+			scale[k] = extent > 0.0 ? N/extent : 0.0;
+			for(int j=0;j<N;j++) n[k][j] = 0;
+		}
+	}
+	int binOf (const Vector3d& x, int k) const {int b = int ((x[k]-lo[k])*scale[k]); return b < 0 ? 0 : (b >= N ? N-1 : b);}
+	void add (const Vector3d& x) {
+		for(int k=0;k<3;k++) {
+			int j = binOf (x,k);
+			box[k][j].add (x);
+			n[k][j]++;
+		}
+	}
+	void merge (const Bins& o) {
+		for(int k=0;k<3;k++)
+			for(int j=0;j<N;j++) {
+				box[k][j].merge (o.box[k][j]);
+				n[k][j] += o.n[k][j];
+			}
+	}
+};
+
+/// true for points below the bin boundary split on axis k
+struct BelowBin
+{
+	const std::vector<Vector3d>& p;
+	const Bins& bins;
+	int k, split;
+	BelowBin (const std::vector<Vector3d>& p_, const Bins& b_, int k_, int s_) : p (p_), bins (b_), k (k_), split (s_) {}
+	bool operator () (int i) const {return bins.binOf (p[i],k) < split;}
+};
+
+/// reduziert p[idx[0..count-1]] in r; ab grain Punkten in Teilstuecken als Tasks
+template<class R>
+void reduce (const std::vector<Vector3d>& p, const int* idx, int count, int grain, R& r)
+{
+	if (count < 2*grain) {
+		for(int i=0;i<count;i++)
+			r.add (p[idx[i]]);
+		return;
+	}
+
+	int chunks = std::min (count/grain,64);
+	std::vector<R> part (chunks,r);
+	for(int c=0;c<chunks;c++) {
+#pragma omp task shared(p,part) firstprivate(c)
+		{
+			int b = int ((long long)count*c/chunks);
+			int e = int ((long long)count*(c+1)/chunks);
+			for(int i=b;i<e;i++)
+				part[c].add (p[idx[i]]);
+		}
+	}
+#pragma omp taskwait
+	for(int c=0;c<chunks;c++)
+		r.merge (part[c]);
+}
+
+/// kleinste Kugel, die die Kugeln a und b enthaelt
+Sphere enclose (const Sphere& a, const Sphere& b)
+{
+	Vector3d d = b.center-a.center;
+	double dist = d.length ();
+	if (dist+b.radius <= a.radius) return a;
+	if (dist+a.radius <= b.radius) return b;
+
+	Sphere s;
+	s.radius = 0.5*(dist+a.radius+b.radius);
+	s.center = a.center + d*((s.radius-a.radius)/dist);
+	return s;
+}
+
+/// Abstand^2 von q zur Kugel (0 innerhalb, unendlich fuer leere Kugeln)
+double lowerBound (const Vector3d& q, const Sphere& s)
+{
+	if (s.radius < 0.0) return 1e300;
+	double d = (q-s.center).length ()-s.radius;
+	return d > 0.0 ? d*d : 0.0;
+}
+
+/// naechster Punkt im Dreieck abc zu p (Ericson, Real-Time Collision Detection 5.1.5)
+Vector3d closestOnTriangle (const Vector3d& p, const Vector3d& a, const Vector3d& b, const Vector3d& c)
+{
+	Vector3d ab = b-a, ac = c-a, ap = p-a;
+	double d1 = ab*ap, d2 = ac*ap;
+	if (d1 <= 0.0 && d2 <= 0.0) return a;
+
+	Vector3d bp = p-b;
+	double d3 = ab*bp, d4 = ac*bp;
+	if (d3 >= 0.0 && d4 <= d3) return b;
+
+	double vc = d1*d4-d3*d2;
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) return a + ab*(d1/(d1-d3));
+
+	Vector3d cp = p-c;
+	double d5 = ab*cp, d6 = ac*cp;
+	if (d6 >= 0.0 && d5 <= d6) return c;
+
+	double vb = d5*d2-d1*d6;
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) return a + ac*(d2/(d2-d6));
+
+	double va = d3*d6-d5*d4;
+	if (va <= 0.0 && (d4-d3) >= 0.0 && (d5-d6) >= 0.0) return b + (c-b)*((d4-d3)/((d4-d3)+(d5-d6)));
+
+	double denom = 1.0/(va+vb+vc);
+	return a + ab*(vb*denom) + ac*(vc*denom);
+}
+
+/// Parameterintervall [t0,t1], in dem o+t*d die Kugel s trifft
+bool raySphere (const Vector3d& o, const Vector3d& d, const Sphere& s, double& t0, double& t1)
+{
+	if (s.radius < 0.0) return false;
+	Vector3d oc = s.center-o;
+	double b = oc*d;
+	double dd = d*d;
+	double disc = b*b - dd*(oc*oc - s.radius*s.radius);
+	if (disc < 0.0) return false;
+	double sq = sqrt (disc);
+	t0 = (b-sq)/dd;
+	t1 = (b+sq)/dd;
+	return true;
+}
+
+/// Strahl fuer den wasserdichten Dreieckstest (Woop, Benthin, Wald 2013):
+/// die Strahlrichtung wird per Scherung auf die z-Achse abgebildet, dann
+/// entscheiden die 2D-Kantenfunktionen konsistent fuer benachbarte Dreiecke
+struct WatertightRay
+{
+	Vector3d o;
+	int kx, ky, kz;
+	double Sx, Sy, Sz;
+
+	WatertightRay () {}
+	WatertightRay (const Vector3d& o_, const Vector3d& d) : o (o_) {
+		kz = (fabs (d[0]) > fabs (d[1])) ? (fabs (d[0]) > fabs (d[2]) ? 0 : 2) : (fabs (d[1]) > fabs (d[2]) ? 1 : 2);
+		kx = (kz+1)%3;
+		ky = (kx+1)%3;
+		if (d[kz] < 0.0) std::swap (kx,ky);
+		Sx = d[kx]/d[kz];
+		Sy = d[ky]/d[kz];
+		Sz = 1.0/d[kz];
+	}
+
+	/// Treffer mit 0 < t < tmax, beide Seiten des Dreiecks
+	bool hit (const Vector3d& a, const Vector3d& b, const Vector3d& c, double tmax, double& t) const {
+		Vector3d A = a-o, B = b-o, C = c-o;
+		double Ax = A[kx]-Sx*A[kz], Ay = A[ky]-Sy*A[kz];
+		double Bx = B[kx]-Sx*B[kz], By = B[ky]-Sy*B[kz];
+		double Cx = C[kx]-Sx*C[kz], Cy = C[ky]-Sy*C[kz];
+
+		double U = Cx*By-Cy*Bx;
+		double V = Ax*Cy-Ay*Cx;
+		double W = Bx*Ay-By*Ax;
+		if ((U < 0.0 || V < 0.0 || W < 0.0) && (U > 0.0 || V > 0.0 || W > 0.0))
+			return false;
+
+		double det = U+V+W;
+		if (det == 0.0)
+			return false;
+
+		double T = U*Sz*A[kz] + V*Sz*B[kz] + W*Sz*C[kz];
+		t = T/det;
+		return t > 0.0 && t < tmax;
+	}
+};
+
+/// Bitmaske der Strahlen im Paket, die die Kugel vor ihrem bisherigen t treffen
+template<int W>
+int packetSphere (const RayPacket<W>& p, const Sphere& s, int active)
+{
+	if (s.radius < 0.0) return 0;
+	int mask = 0;
+	double rr = s.radius*s.radius;
+#ifdef __SSE2__
+	__m128d cx = _mm_set1_pd (s.center[0]), cy = _mm_set1_pd (s.center[1]), cz = _mm_set1_pd (s.center[2]);
+	__m128d r2 = _mm_set1_pd (rr), zero = _mm_setzero_pd ();
+	for(int i=0;i<W;i+=2) {
+		__m128d dx = _mm_loadu_pd (p.dx+i), dy = _mm_loadu_pd (p.dy+i), dz = _mm_loadu_pd (p.dz+i);
+		__m128d ocx = _mm_sub_pd (cx,_mm_loadu_pd (p.ox+i));
+		__m128d ocy = _mm_sub_pd (cy,_mm_loadu_pd (p.oy+i));
+		__m128d ocz = _mm_sub_pd (cz,_mm_loadu_pd (p.oz+i));
+		__m128d b = _mm_add_pd (_mm_add_pd (_mm_mul_pd (ocx,dx),_mm_mul_pd (ocy,dy)),_mm_mul_pd (ocz,dz));
+		__m128d dd = _mm_add_pd (_mm_add_pd (_mm_mul_pd (dx,dx),_mm_mul_pd (dy,dy)),_mm_mul_pd (dz,dz));
+		__m128d cc = _mm_sub_pd (_mm_add_pd (_mm_add_pd (_mm_mul_pd (ocx,ocx),_mm_mul_pd (ocy,ocy)),_mm_mul_pd (ocz,ocz)),r2);
+		__m128d disc = _mm_sub_pd (_mm_mul_pd (b,b),_mm_mul_pd (dd,cc));
+		__m128d sq = _mm_sqrt_pd (_mm_max_pd (disc,zero));
+		/// t1 >= 0 und t0 <= t, mit dd > 0 ohne Division
+		__m128d far_ok = _mm_cmpge_pd (_mm_add_pd (b,sq),zero);
+		__m128d near_ok = _mm_cmple_pd (_mm_sub_pd (b,sq),_mm_mul_pd (_mm_loadu_pd (p.t+i),dd));
+		__m128d ok = _mm_and_pd (_mm_and_pd (_mm_cmpge_pd (disc,zero),far_ok),near_ok);
+		mask |= _mm_movemask_pd (ok) << i;
+	}
+#else
+	for(int i=0;i<W;i++) {
+		Vector3d oc (s.center[0]-p.ox[i],s.center[1]-p.oy[i],s.center[2]-p.oz[i]);
+		double b = oc[0]*p.dx[i]+oc[1]*p.dy[i]+oc[2]*p.dz[i];
+		double dd = p.dx[i]*p.dx[i]+p.dy[i]*p.dy[i]+p.dz[i]*p.dz[i];
+		double disc = b*b - dd*(oc*oc-rr);
+		if (disc < 0.0) continue;
+		double sq = sqrt (disc);
+		if (b+sq >= 0.0 && b-sq <= p.t[i]*dd)
+			mask |= 1 << i;
+	}
+#endif
+	return mask & active;
+}
+
+/// (Abstand^2 bzw. Schranke, Knoten/Punkt), kleinstes zuerst
+typedef std::pair<double,int> Entry;
+typedef std::priority_queue<Entry,std::vector<Entry>,std::greater<Entry> > MinQueue;
+typedef std::priority_queue<Entry> MaxQueue;
+
+/// haengt einen separat gebauten Teilbaum an out an, liefert den Index seiner Wurzel
+int splice (std::vector<BVTNode>& out, const std::vector<BVTNode>& sub)
+{
+	int offset = int (out.size ());
+	out.insert (out.end (),sub.begin (),sub.end ());
+	for(size_t i=offset;i<out.size ();i++)
+		if (!out[i].leaf ()) {
+			out[i].left += offset;
+			out[i].right += offset;
+		}
+	return offset;
+}
+
+}
+
+BVTOptions::BVTOptions (Strategy s) : strategy (s), leaf_size (maximal_points), max_depth (64), task_size (task_points)
+{
+}
+
 // Construktor
-BVT::BVT (const std::vector<Vector3d>& points) : points_ (points), ball_ (points)
-{
-
-  for(unsigned int i=0;i<points_.size();i++)
-    mass_center_ += points_[i];
-  mass_center_ /= points_.size();
-
-	// Compute inetria matrix
-  for(unsigned int i=0;i<points_.size ();i++) {
-    const Vector3d& r = points_[i] - mass_center_;
-    inertia_(0,0) += r[1]*r[1]+r[2]*r[2];
-    inertia_(1,1) += r[0]*r[0]+r[2]*r[2];
-    inertia_(2,2) += r[0]*r[0]+r[1]*r[1];
-    inertia_(0,1) -= r[0]*r[1];
-    inertia_(0,2) -= r[0]*r[2];
-    inertia_(1,2) -= r[1]*r[2];
-  }
- 
-	/// Due to the fact that we work with Matrix4d, expand the last row/column by (0,0,0,1)
-  inertia_(0,3) = inertia_(3,0) = 0.0;
-  inertia_(1,3) = inertia_(3,1) = 0.0;
-  inertia_(2,3) = inertia_(3,2) = 0.0;
-  inertia_(3,3) = 1.0;
-	
-	// Kinder! Blaetter haben NULL-Pointer als Kinder!
-	left_ = NULL;
-	right_ = NULL;
+BVT::BVT (const std::vector<Vector3d>& points, const BVTOptions& options)
+: points_ (NULL), index_ (NULL), nodes_ (NULL), nr_of_points_ (0), nr_of_nodes_ (0), file_ (NULL),
+	input_ (&points), options_ (options)
+{
+	if (options_.leaf_size < 1) options_.leaf_size = 1;
+	if (options_.task_size < 1) options_.task_size = 1;
+
+	int n = int (points.size ());
+	own_index_.resize (n);
+	for(int i=0;i<n;i++)
+		own_index_[i] = i;
+
+	own_nodes_.reserve (n > 0 ? 2*(n/options_.leaf_size)+1 : 1);
+	std::vector<Vector3d> work;
+
+	/// ein Thread startet, die grossen Teilbaeume verteilen sich als Tasks
+#pragma omp parallel
+#pragma omp single
+	build (0,n,0,own_nodes_,work);
+
+	/// Punkte einmal in Blatt-Reihenfolge ablegen
+	own_points_.resize (n);
+#pragma omp parallel for
+	for(int i=0;i<n;i++)
+		own_points_[i] = points[own_index_[i]];
+	input_ = NULL;
+	attach ();
+}
+
+BVT::BVT (BVTFile * file)
+: points_ (file->points ()), index_ (file->permutation ()), nodes_ (file->nodes ()),
+	nr_of_points_ (file->nr_of_points ()), nr_of_nodes_ (file->nr_of_nodes ()), file_ (file),
+	input_ (NULL), options_ (file->options ())
+{
+}
+
+BVT::~BVT ()
+{
+	delete file_;
+}
+
+void BVT::attach ()
+{
+	points_ = own_points_.empty () ? NULL : &own_points_[0];
+	index_ = own_index_.empty () ? NULL : &own_index_[0];
+	nodes_ = own_nodes_.empty () ? NULL : &own_nodes_[0];
+	nr_of_points_ = int (own_points_.size ());
+	nr_of_nodes_ = int (own_nodes_.size ());
+}
+
+void BVT::detach ()
+{
+	if (!file_) return;
+	own_points_.assign (points_,points_+nr_of_points_);
+	own_index_.assign (index_,index_+nr_of_points_);
+	own_nodes_.assign (nodes_,nodes_+nr_of_nodes_);
+	delete file_;
+	file_ = NULL;
+	attach ();
+}
+
+int BVT::build (int first, int count, int depth, std::vector<BVTNode>& out, std::vector<Vector3d>& work)
+{
+	const std::vector<Vector3d>& p = *input_;
+
+	int id = int (out.size ());
+	out.push_back (BVTNode ());
+	out[id].left = out[id].right = -1;
+	out[id].first = first;
+	out[id].count = count;
+
+	// smallest enclosing sphere of the range (Welzl on a scratch copy)
+	if (int (work.size ()) < count) work.resize (count);
+	for(int i=0;i<count;i++)
+		work[i] = p[own_index_[first+i]];
+
+	bool leaf = count <= options_.leaf_size || depth >= options_.max_depth;
+	if (leaf || count < options_.task_size) {
+		out[id].ball = SphereBatch::exact (count > 0 ? &work[0] : NULL, count, (unsigned int)id);
+		if (leaf)
+			return id;
+
+		int nl = split (first,count);
+
+		/// Kinder direkt hinter dem Knoten (links) bzw. hinter dem linken Teilbaum (rechts)
+		int l = build (first,nl,depth+1,out,work);
+		int r = build (first+nl,count-nl,depth+1,out,work);
+		out[id].left = l;
+		out[id].right = r;
+		return id;
+	}
+
+	/// grosser Knoten: die eigene Kugel und beide Teilbaeume laufen als Tasks,
+	/// die Teilbaeume in eigene Knotenlisten, die danach in Preorder angehaengt werden
+	Sphere ball;
+#pragma omp task shared(ball,work) firstprivate(count,id)
+	ball = SphereBatch::exact (&work[0], count, (unsigned int)id);
+
+	int nl = split (first,count);
+
+	std::vector<BVTNode> left, right;
+#pragma omp task shared(left) firstprivate(first,nl,depth)
+	{
+		std::vector<Vector3d> w;
+		build (first,nl,depth+1,left,w);
+	}
+#pragma omp task shared(right) firstprivate(first,nl,count,depth)
+	{
+		std::vector<Vector3d> w;
+		build (first+nl,count-nl,depth+1,right,w);
+	}
+#pragma omp taskwait
+
+	int l = splice (out,left);
+	int r = splice (out,right);
+	out[id].ball = ball;
+	out[id].left = l;
+	out[id].right = r;
+	return id;
 }
 
 /********************************************************
-** Construcs an optimal splitting of points_ into two disjoint sets
-** links and rechts and increases the BVT-tree by 1. 
+** Construcs an optimal splitting of the points in
+** index_[first .. first+count-1] into two disjoint sets
+** and returns the size of the first one.
 ** The splitting follows the idea of the lecture:
-** (1) Compute the inertia matrix M of points_
+** (1) Compute the inertia matrix M of the points
 ** (2) Compute the eigenvalues/eigenvectors of M by M.jacoby() (vecmath!)
 ** (3) Let v be the most stable eigenvector and c be the mass center.
-**     Split points_ by plane p: (x-c)^T*v = 0 
+**     Split the points by plane p: (x-c)^T*v = 0 
 *********************************************************/
-void BVT::split ()
+int BVT::split (int first, int count)
+{
+	switch (options_.strategy) {
+		case BVTOptions::MEDIAN: return splitMedian (first,count);
+		case BVTOptions::SAH:    return splitSAH (first,count);
+		default:                 return splitPCA (first,count);
+	}
+}
+
+int BVT::splitPCA (int first, int count)
 {
-	std::vector<Vector3d> links;
-	std::vector<Vector3d> rechts;
+	const std::vector<Vector3d>& p = *input_;
+	std::vector<int>::iterator begin = own_index_.begin ()+first;
+	std::vector<int>::iterator end = begin+count;
+	int grain = options_.task_size/2;
+
+	/// mass center of point set
+	Sum sum;
+	reduce (p,&own_index_[first],count,grain,sum);
+	Vector3d mass_center = sum.s/count;
+
+	/// inertia matrix of point set, only needed during construction
+	Inertia in (mass_center);
+	reduce (p,&own_index_[first],count,grain,in);
+	Matrix4d inertia;
+	inertia(0,0) = in.m[0];
+	inertia(1,1) = in.m[1];
+	inertia(2,2) = in.m[2];
+	inertia(0,1) = in.m[3];
+	inertia(0,2) = in.m[4];
+	inertia(1,2) = in.m[5];
 
 	// Computes the eigenvalues/vectors from the inertia matrix
 	Vector4d eigenvalue;
 	Matrix4d eigenvector;
 	int nrot; /// not important
+	inertia.jacobi (eigenvalue, eigenvector, nrot);
 
-	/// Dont forget to compute inertia_ first!
-	inertia_.jacobi (eigenvalue, eigenvector, nrot);
+	/// kleinstes Traegheitsmoment = Richtung der groessten Ausdehnung
+	/// (nur die ersten drei, der vierte Eintrag ist die aufgefuellte 1)
+	int k = 0;
+	for(int j=1;j<3;j++)
+		if (eigenvalue[j] < eigenvalue[k]) k = j;
+	Vector3d v (eigenvector(0,k), eigenvector(1,k), eigenvector(2,k));
 
-	/// ADD YOUR CODE HERE!!!
+	int nl = int (std::partition (begin,end,BelowPlane (p,mass_center,v)) - begin);
 
+	/// entartet (alles auf einer Seite): am Median entlang v teilen
+	if (nl == 0 || nl == count) {
+		nl = count/2;
+		std::nth_element (begin,begin+nl,end,AlongAxis (p,v));
+	}
+	return nl;
+}
+
+/// Objekt-Median entlang der laengsten Achse der Box
+int BVT::splitMedian (int first, int count)
+{
+	const std::vector<Vector3d>& p = *input_;
+	std::vector<int>::iterator begin = own_index_.begin ()+first;
+	std::vector<int>::iterator end = begin+count;
 
-	/// Kinder sind wieder Baeume! Wichtig das NEW!
-	left_ = new BVT (links);
-	right_ = new BVT (rechts);
+	Bounds b;
+	reduce (p,&own_index_[first],count,options_.task_size/2,b);
+	Vector3d e = b.hi-b.lo;
+	int k = (e[0] > e[1]) ? (e[0] > e[2] ? 0 : 2) : (e[1] > e[2] ? 1 : 2);
+
+	int nl = count/2;
+	std::nth_element (begin,begin+nl,end,AlongCoordinate (p,k));
+	return nl;
 }
 
+/// Binned SAH: Kosten = A(links)*n(links) + A(rechts)*n(rechts),
+/// A = Oberflaeche der Huellkugel der Teilmenge (ueber die Box geschaetzt)
+int BVT::splitSAH (int first, int count)
+{
+	const std::vector<Vector3d>& p = *input_;
+	std::vector<int>::iterator begin = own_index_.begin ()+first;
+	std::vector<int>::iterator end = begin+count;
+	int grain = options_.task_size/2;
+	const int N = Bins::N;
+
+	Bounds all;
+	reduce (p,&own_index_[first],count,grain,all);
+	Bins bins (all);
+	reduce (p,&own_index_[first],count,grain,bins);
+
+	double best = 1e300;
+	int best_k = -1, best_split = 0;
+	for(int k=0;k<3;k++) {
+		if (bins.scale[k] <= 0.0) continue;
+
+		/// von rechts aufsummieren, dann von links durchlaufen
+		double right_area[N];
+		int right_n[N];
+		Bounds acc;
+		int cnt = 0;
+		for(int j=N-1;j>0;j--) {
+			acc.merge (bins.box[k][j]);
+			cnt += bins.n[k][j];
+			right_area[j] = acc.area ();
+			right_n[j] = cnt;
+		}
+		acc = Bounds ();
+		cnt = 0;
+		for(int j=1;j<N;j++) {
+			acc.merge (bins.box[k][j-1]);
+			cnt += bins.n[k][j-1];
+			if (cnt == 0 || right_n[j] == 0) continue;
+			double cost = acc.area ()*cnt + right_area[j]*right_n[j];
+			if (cost < best) {
+				best = cost;
+				best_k = k;
+				best_split = j;
+			}
+		}
+	}
+
+	if (best_k < 0)
+		return splitMedian (first,count);
+
+	int nl = int (std::partition (begin,end,BelowBin (p,bins,best_k,best_split)) - begin);
+	if (nl == 0 || nl == count)
+		return splitMedian (first,count);
+	return nl;
+}
+
+BVTStats BVT::statistics () const
+{
+	BVTStats s;
+	s.nodes = nr_of_nodes ();
+	s.leaves = 0;
+	s.depth = 0;
+	s.avg_leaf_size = 0.0;
+	s.sah_cost = 0.0;
+	if (nr_of_nodes_ == 0) return s;
+
+	double root_area = nodes_[0].ball.radius*nodes_[0].ball.radius;
+	if (root_area <= 0.0) root_area = 1.0;
+
+	/// Tiefe pro Knoten: Kinder liegen immer hinter den Eltern
+	std::vector<int> depth (nr_of_nodes_,0);
+	for(int i=0;i<s.nodes;i++) {
+		const BVTNode& n = nodes_[i];
+		double area = n.ball.radius*n.ball.radius/root_area;
+		if (n.leaf ()) {
+			s.leaves++;
+			s.avg_leaf_size += n.count;
+			s.sah_cost += area*n.count;
+			s.depth = std::max (s.depth,depth[i]);
+		}
+		else {
+			s.sah_cost += area;
+			depth[n.left] = depth[n.right] = depth[i]+1;
+		}
+	}
+	s.avg_leaf_size /= s.leaves;
+	return s;
+}
+
+int BVT::overlap (const Sphere& s, std::vector<int>& leaves) const
+{
+	leaves.clear ();
+	if (nr_of_nodes_ == 0) return 0;
+
+	int visited = 0;
+	std::vector<int> stack;
+	stack.reserve (2*options_.max_depth+2);
+	stack.push_back (0);
+	while (!stack.empty ()) {
+		const BVTNode& n = nodes_[stack.back ()];
+		stack.pop_back ();
+		visited++;
+		double r = n.ball.radius+s.radius;
+		if ((n.ball.center-s.center).lengthSquared () > r*r)
+			continue;
+		if (n.leaf ())
+			leaves.push_back (int (&n-&nodes_[0]));
+		else {
+			stack.push_back (n.right);
+			stack.push_back (n.left);
+		}
+	}
+	return visited;
+}
+
+int BVT::overlap (const BVT& other, const Matrix4d& T, std::vector<std::pair<int,int> >& pairs,
+									bool first_hit, double tolerance) const
+{
+	pairs.clear ();
+	if (nr_of_nodes_ == 0 || other.nr_of_nodes_ == 0) return 0;
+
+	int visited = 0;
+	std::vector<std::pair<int,int> > stack;
+	stack.reserve (4*options_.max_depth+4);
+	stack.push_back (std::make_pair (0,0));
+	while (!stack.empty ()) {
+		int i = stack.back ().first;
+		int j = stack.back ().second;
+		stack.pop_back ();
+		visited++;
+
+		const BVTNode& a = nodes_[i];
+		const BVTNode& b = other.nodes_[j];
+		double r = a.ball.radius+b.ball.radius+tolerance;
+		if ((a.ball.center - T*b.ball.center).lengthSquared () > r*r)
+			continue;
+
+		if (a.leaf () && b.leaf ()) {
+			pairs.push_back (std::make_pair (i,j));
+			if (first_hit) break;
+		}
+		/// die groessere Kugel wird zuerst zerlegt
+		else if (b.leaf () || (!a.leaf () && a.ball.radius >= b.ball.radius)) {
+			stack.push_back (std::make_pair (a.right,j));
+			stack.push_back (std::make_pair (a.left,j));
+		}
+		else {
+			stack.push_back (std::make_pair (i,b.right));
+			stack.push_back (std::make_pair (i,b.left));
+		}
+	}
+	return visited;
+}
+
+void BVT::setMesh (const std::vector<int>& indices)
+{
+	int n = nr_of_points ();
+	int m = int (indices.size ())/3;
 
+	/// Position jedes Eingabepunkts in points_
+	std::vector<int> where (n);
+	for(int i=0;i<n;i++)
+		where[index_[i]] = i;
+
+	/// nach erster Ecke sortieren (Counting Sort)
+	tri_start_.assign (n+1,0);
+	for(int t=0;t<m;t++)
+		tri_start_[where[indices[3*t]]+1]++;
+	for(int i=0;i<n;i++)
+		tri_start_[i+1] += tri_start_[i];
+
+	tri_.resize (m);
+	std::vector<int> fill (tri_start_.begin (),tri_start_.end ()-1);
+	for(int t=0;t<m;t++) {
+		Triangle& tri = tri_[fill[where[indices[3*t]]]++];
+		for(int j=0;j<3;j++)
+			tri.v[j] = where[indices[3*t+j]];
+		tri.id = t;
+	}
+	updateMeshBounds ();
+}
+
+void BVT::updateMeshBounds ()
+{
+	mesh_ball_.clear ();
+	if (tri_start_.empty ()) return;
+
+	mesh_ball_.resize (nr_of_nodes_);
+	std::vector<Vector3d> corners;
+	for(int i=nr_of_nodes ()-1;i>=0;i--) {
+		const BVTNode& n = nodes_[i];
+		Sphere& ball = mesh_ball_[i];
+		if (!n.leaf ()) {
+			const Sphere& l = mesh_ball_[n.left];
+			const Sphere& r = mesh_ball_[n.right];
+			ball = (l.radius < 0.0) ? r : (r.radius < 0.0 ? l : enclose (l,r));
+			continue;
+		}
+		corners.clear ();
+		for(int t=tri_start_[n.first];t<tri_start_[n.first+n.count];t++)
+			for(int j=0;j<3;j++)
+				corners.push_back (points_[tri_[t].v[j]]);
+		if (corners.empty ())
+			ball.radius = -1.0;
+		else
+			ball = SphereBatch::approx (&corners[0],int (corners.size ()));
+	}
+}
+
+void BVT::nearest (const Vector3d& q, int k, std::vector<int>& result, std::vector<double>* dist) const
+{
+	result.clear ();
+	if (dist) dist->clear ();
+	if (nr_of_nodes_ == 0 || k <= 0) return;
+
+	MaxQueue best;
+	MinQueue queue;
+	queue.push (Entry (lowerBound (q,nodes_[0].ball),0));
+	while (!queue.empty ()) {
+		Entry e = queue.top ();
+		queue.pop ();
+		if (int (best.size ()) == k && e.first >= best.top ().first)
+			break;
+
+		const BVTNode& n = nodes_[e.second];
+		if (n.leaf ()) {
+			for(int i=n.first;i<n.first+n.count;i++) {
+				double d = (points_[i]-q).lengthSquared ();
+				if (int (best.size ()) < k)
+					best.push (Entry (d,i));
+				else if (d < best.top ().first) {
+					best.pop ();
+					best.push (Entry (d,i));
+				}
+			}
+		}
+		else {
+			queue.push (Entry (lowerBound (q,nodes_[n.left].ball),n.left));
+			queue.push (Entry (lowerBound (q,nodes_[n.right].ball),n.right));
+		}
+	}
+
+	/// der Heap liefert den groessten zuerst
+	result.resize (best.size ());
+	if (dist) dist->resize (best.size ());
+	for(int j=int (best.size ())-1;j>=0;j--) {
+		result[j] = index_[best.top ().second];
+		if (dist) (*dist)[j] = sqrt (best.top ().first);
+		best.pop ();
+	}
+}
+
+void BVT::within (const Vector3d& q, double r, std::vector<int>& result) const
+{
+	result.clear ();
+	if (nr_of_nodes_ == 0) return;
+
+	std::vector<int> stack;
+	stack.push_back (0);
+	while (!stack.empty ()) {
+		const BVTNode& n = nodes_[stack.back ()];
+		stack.pop_back ();
+		if (lowerBound (q,n.ball) > r*r)
+			continue;
+		if (n.leaf ()) {
+			for(int i=n.first;i<n.first+n.count;i++)
+				if ((points_[i]-q).lengthSquared () <= r*r)
+					result.push_back (index_[i]);
+		}
+		else {
+			stack.push_back (n.right);
+			stack.push_back (n.left);
+		}
+	}
+}
+
+double BVT::closestPoint (const Vector3d& q, Vector3d& point, int* triangle) const
+{
+	if (triangle) *triangle = -1;
+	if (nr_of_nodes_ == 0) return -1.0;
+
+	/// mit Netz wird ueber die Dreieckskugeln abgestiegen
+	bool mesh = !tri_.empty ();
+	const Sphere* ball = mesh ? &mesh_ball_[0] : NULL;
+	double best = 1e300;
+	MinQueue queue;
+	queue.push (Entry (lowerBound (q,mesh ? ball[0] : nodes_[0].ball),0));
+	while (!queue.empty ()) {
+		Entry e = queue.top ();
+		queue.pop ();
+		if (e.first >= best)
+			break;
+
+		const BVTNode& n = nodes_[e.second];
+		if (n.leaf ()) {
+			if (!mesh) {
+				for(int i=n.first;i<n.first+n.count;i++) {
+					double d = (points_[i]-q).lengthSquared ();
+					if (d < best) {
+						best = d;
+						point = points_[i];
+					}
+				}
+				continue;
+			}
+			for(int t=tri_start_[n.first];t<tri_start_[n.first+n.count];t++) {
+				const Triangle& tri = tri_[t];
+				Vector3d x = closestOnTriangle (q,points_[tri.v[0]],points_[tri.v[1]],points_[tri.v[2]]);
+				double d = (x-q).lengthSquared ();
+				if (d < best) {
+					best = d;
+					point = x;
+					if (triangle) *triangle = tri.id;
+				}
+			}
+		}
+		else {
+			queue.push (Entry (lowerBound (q,mesh ? ball[n.left] : nodes_[n.left].ball),n.left));
+			queue.push (Entry (lowerBound (q,mesh ? ball[n.right] : nodes_[n.right].ball),n.right));
+		}
+	}
+	return sqrt (best);
+}
+
+double BVT::intersect (const Vector3d& o, const Vector3d& d, int* triangle, double tmax) const
+{
+	if (triangle) *triangle = -1;
+	if (tri_.empty ()) return -1.0;
+
+	WatertightRay ray (o,d);
+	double best = tmax;
+	bool found = false;
+
+	/// (Knoten, Eintrittsparameter), der naehere Kind-Knoten liegt oben
+	std::vector<std::pair<int,double> > stack;
+	double t0, t1;
+	if (!raySphere (o,d,mesh_ball_[0],t0,t1) || t1 < 0.0) return -1.0;
+	stack.push_back (std::make_pair (0,t0));
+	while (!stack.empty ()) {
+		int i = stack.back ().first;
+		double enter = stack.back ().second;
+		stack.pop_back ();
+		if (enter >= best) continue;
+
+		const BVTNode& n = nodes_[i];
+		if (n.leaf ()) {
+			for(int t=tri_start_[n.first];t<tri_start_[n.first+n.count];t++) {
+				const Triangle& tri = tri_[t];
+				double th;
+				if (ray.hit (points_[tri.v[0]],points_[tri.v[1]],points_[tri.v[2]],best,th)) {
+					best = th;
+					found = true;
+					if (triangle) *triangle = tri.id;
+				}
+			}
+			continue;
+		}
+
+		double l0, l1, r0, r1;
+		bool hl = raySphere (o,d,mesh_ball_[n.left],l0,l1) && l1 >= 0.0 && l0 < best;
+		bool hr = raySphere (o,d,mesh_ball_[n.right],r0,r1) && r1 >= 0.0 && r0 < best;
+		if (hl && hr && l0 > r0) {
+			stack.push_back (std::make_pair (n.left,l0));
+			stack.push_back (std::make_pair (n.right,r0));
+		}
+		else {
+			if (hr) stack.push_back (std::make_pair (n.right,r0));
+			if (hl) stack.push_back (std::make_pair (n.left,l0));
+		}
+	}
+	return found ? best : -1.0;
+}
+
+template<int W>
+void BVT::intersect (RayPacket<W>& p) const
+{
+	if (tri_.empty ()) return;
+
+	WatertightRay ray[W];
+	for(int i=0;i<W;i++)
+		ray[i] = WatertightRay (Vector3d (p.ox[i],p.oy[i],p.oz[i]),Vector3d (p.dx[i],p.dy[i],p.dz[i]));
+
+	/// Reihenfolge der Kinder nach dem ersten Strahl des Pakets
+	Vector3d o0 (p.ox[0],p.oy[0],p.oz[0]);
+	Vector3d d0 (p.dx[0],p.dy[0],p.dz[0]);
+
+	/// (Knoten, Strahlen, die den Elternknoten getroffen haben)
+	std::vector<std::pair<int,int> > stack;
+	stack.push_back (std::make_pair (0,(1 << W)-1));
+	while (!stack.empty ()) {
+		int i = stack.back ().first;
+		int active = packetSphere (p,mesh_ball_[i],stack.back ().second);
+		stack.pop_back ();
+		if (!active) continue;
+
+		const BVTNode& n = nodes_[i];
+		if (n.leaf ()) {
+			for(int t=tri_start_[n.first];t<tri_start_[n.first+n.count];t++) {
+				const Triangle& tri = tri_[t];
+				const Vector3d& a = points_[tri.v[0]];
+				const Vector3d& b = points_[tri.v[1]];
+				const Vector3d& c = points_[tri.v[2]];
+				for(int j=0;j<W;j++) {
+					double th;
+					if ((active >> j & 1) && ray[j].hit (a,b,c,p.t[j],th)) {
+						p.t[j] = th;
+						p.triangle[j] = tri.id;
+					}
+				}
+			}
+			continue;
+		}
+
+		if ((mesh_ball_[n.left].center-o0)*d0 > (mesh_ball_[n.right].center-o0)*d0) {
+			stack.push_back (std::make_pair (n.left,active));
+			stack.push_back (std::make_pair (n.right,active));
+		}
+		else {
+			stack.push_back (std::make_pair (n.right,active));
+			stack.push_back (std::make_pair (n.left,active));
+		}
+	}
+}
+
+template void BVT::intersect<4> (RayPacket<4>&) const;
+template void BVT::intersect<8> (RayPacket<8>&) const;
+
+void BVT::nearest (const std::vector<Vector3d>& q, int k, std::vector<int>& result) const
+{
+	int m = int (q.size ());
+	result.assign (size_t (m)*k,-1);
+#pragma omp parallel
+	{
+		std::vector<int> one;
+#pragma omp for schedule(dynamic,64)
+		for(int i=0;i<m;i++) {
+			nearest (q[i],k,one);
+			std::copy (one.begin (),one.end (),result.begin ()+size_t (i)*k);
+		}
+	}
+}
+
+void BVT::closestPoint (const std::vector<Vector3d>& q, std::vector<Vector3d>& point, std::vector<double>& dist) const
+{
+	int m = int (q.size ());
+	point.resize (m);
+	dist.resize (m);
+#pragma omp parallel for schedule(dynamic,64)
+	for(int i=0;i<m;i++)
+		dist[i] = closestPoint (q[i],point[i]);
+}
+
+int BVT::selectLOD (const BVTView& view, std::vector<int>& nodes) const
+{
+	nodes.clear ();
+	if (nr_of_nodes_ == 0) return 0;
+
+	const Matrix4d& M = view.modelview;
+	double scale = Vector3d (M(0,0),M(1,0),M(2,0)).length ();
+	double side_x = sqrt (1.0+view.tan_x*view.tan_x);
+	double side_y = sqrt (1.0+view.tan_y*view.tan_y);
+
+	int visited = 0;
+	std::vector<int> stack;
+	stack.push_back (0);
+	while (!stack.empty ()) {
+		int i = stack.back ();
+		stack.pop_back ();
+		visited++;
+
+		const BVTNode& n = nodes_[i];
+		Vector3d e = M*n.ball.center;
+		double r = n.ball.radius*scale;
+		double depth = -e[2];
+
+		/// ganz hinter der Kamera oder ausserhalb einer Seitenebene
+		if (depth+r <= 0.0) continue;
+		if (fabs (e[0])-depth*view.tan_x > r*side_x) continue;
+		if (fabs (e[1])-depth*view.tan_y > r*side_y) continue;
+
+		/// Kamera in oder dicht an der Kugel: immer verfeinern
+		double projected = (depth > r) ? view.focal*r/depth : 1e300;
+		if (n.leaf () || projected <= view.max_pixels)
+			nodes.push_back (i);
+		else {
+			stack.push_back (n.right);
+			stack.push_back (n.left);
+		}
+	}
+	return visited;
+}
+
+void BVT::computeLevels ()
+{
+	levels_.clear ();
+	level_start_.clear ();
+	if (nr_of_nodes_ == 0) return;
+
+	levels_.reserve (nr_of_nodes_);
+	levels_.push_back (0);
+	int begin = 0;
+	while (begin < int (levels_.size ())) {
+		int end = int (levels_.size ());
+		level_start_.push_back (begin);
+		for(int i=begin;i<end;i++) {
+			const BVTNode& n = nodes_[levels_[i]];
+			if (!n.leaf ()) {
+				levels_.push_back (n.left);
+				levels_.push_back (n.right);
+			}
+		}
+		begin = end;
+	}
+	level_start_.push_back (int (levels_.size ()));
+}
+
+bool BVT::refit (const std::vector<Vector3d>& points, bool exact_leaves)
+{
+	int n = nr_of_points ();
+	if (int (points.size ()) != n)
+		return false;
+	/// leerer Baum: nichts anzupassen, &points_[0] waere ungueltig
+	if (n == 0 || nr_of_nodes_ == 0)
+		return true;
+	detach ();
+#pragma omp parallel for
+	for(int i=0;i<n;i++)
+		own_points_[i] = points[index_[i]];
+
+	if (level_start_.empty ())
+		computeLevels ();
+
+	/// Blaetter in Preorder liegen lueckenlos hintereinander in points_,
+	/// ihre Kugeln also in einem SphereBatch-Durchlauf
+	std::vector<int> leaves, offsets;
+	for(int i=0;i<nr_of_nodes_;i++)
+		if (nodes_[i].leaf ()) {
+			leaves.push_back (i);
+			offsets.push_back (nodes_[i].first);
+		}
+	offsets.push_back (n);
+	SphereBatch batch;
+	batch.compute (own_points_,offsets,exact_leaves ? SphereBatch::EXACT : SphereBatch::APPROX);
+	for(int k=0;k<batch.size ();k++)
+		own_nodes_[leaves[k]].ball = batch.sphere (k);
+
+	/// innere Knoten, tiefste Ebene zuerst, die Kinder einer Ebene sind dann schon fertig
+	for(int l=int (level_start_.size ())-2;l>=0;l--) {
+		int begin = level_start_[l];
+		int end = level_start_[l+1];
+#pragma omp parallel for schedule(dynamic,64) if(end-begin > 256)
+		for(int j=begin;j<end;j++) {
+			BVTNode& node = own_nodes_[levels_[j]];
+			if (!node.leaf ())
+				node.ball = enclose (nodes_[node.left].ball,nodes_[node.right].ball);
+		}
+	}
+	updateMeshBounds ();
+	return true;
+}
+
+int BVT::rotate ()
+{
+	int rotations = 0;
+	detach ();
+
+	/// Kinder liegen hinter den Eltern: rueckwaerts ist von unten nach oben
+	for(int i=nr_of_nodes ()-1;i>=0;i--) {
+		BVTNode& node = own_nodes_[i];
+		if (node.leaf ()) continue;
+		BVTNode& L = own_nodes_[node.left];
+		BVTNode& R = own_nodes_[node.right];
+
+		/// links: (a,b),R -> a,(b,R)   rechts: L,(c,d) -> (L,c),d
+		double gain_left = 0.0, gain_right = 0.0;
+		Sphere left_ball, right_ball;
+		if (!L.leaf ()) {
+			left_ball = enclose (nodes_[L.right].ball,R.ball);
+			gain_left = L.ball.radius*L.ball.radius - left_ball.radius*left_ball.radius;
+		}
+		if (!R.leaf ()) {
+			right_ball = enclose (L.ball,nodes_[R.left].ball);
+			gain_right = R.ball.radius*R.ball.radius - right_ball.radius*right_ball.radius;
+		}
+
+		if (gain_left > 0.0 && gain_left >= gain_right) {
+			/// L wird zum neuen rechten Kind (b,R)
+			int l = node.left, a = L.left, b = L.right, r = node.right;
+			L.left = b;
+			L.right = r;
+			L.first = nodes_[b].first;
+			L.count = nodes_[b].count+R.count;
+			L.ball = left_ball;
+			node.left = a;
+			node.right = l;
+			rotations++;
+		}
+		else if (gain_right > 0.0) {
+			/// R wird zum neuen linken Kind (L,c)
+			int l = node.left, r = node.right, c = R.left, d = R.right;
+			R.left = l;
+			R.right = c;
+			R.first = L.first;
+			R.count = L.count+nodes_[c].count;
+			R.ball = right_ball;
+			node.left = r;
+			node.right = d;
+			rotations++;
+		}
+	}
+
+	if (rotations > 0) {
+		/// wieder Preorder herstellen (linkes Kind = i+1)
+		std::vector<BVTNode> out;
+		out.reserve (nr_of_nodes_);
+		relayout (0,out);
+		own_nodes_.swap (out);
+		attach ();
+		levels_.clear ();
+		level_start_.clear ();
+		updateMeshBounds ();
+	}
+	return rotations;
+}
+
+int BVT::relayout (int i, std::vector<BVTNode>& out) const
+{
+	int id = int (out.size ());
+	out.push_back (nodes_[i]);
+	if (!nodes_[i].leaf ()) {
+		int l = relayout (nodes_[i].left,out);
+		int r = relayout (nodes_[i].right,out);
+		out[id].left = l;
+		out[id].right = r;
+	}
+	return id;
+}
@@ -3,49 +3,291 @@
 
 #include "vecmath.h"
 #include <vector>
+#include <utility>
 #include "Sphere.h"
 
 
-/// Klassische rekursive Datenstruktur!
-/** In den Knoten speichern wir die Info (points_, und ball)
-		Die Kinder muessen Pointer sein (c++!)
+/// Ein Knoten des flachen Baums
+/** Kinder sind Indizes in das Knoten-Array (-1 bei Blaettern),
+		die Punkte des Knotens sind BVT::points()[first .. first+count-1].
+*/
+struct BVTNode
+{
+		/// smallest enclosing sphere of the node's points
+		Sphere ball;
+
+		int left;
+		int right;
+
+		int first;
+		int count;
+
+		bool leaf () const {return left < 0;};
+};
+
+
+class BVTFile;
+
+/// W Strahlen o+t*d als SoA fuer die Paket-Traversierung
+template<int W>
+struct RayPacket
+{
+		enum {width = W};
+
+		double ox[W], oy[W], oz[W];
+		double dx[W], dy[W], dz[W];
+
+		/// vorher: maximales t, nachher: erster Treffer (unveraendert ohne Treffer)
+		double t[W];
+
+		/// getroffenes Dreieck, -1 ohne Treffer
+		int triangle[W];
+
+		/// Strahl i setzen, tmax unendlich
+		void set (int i, const Vector3d& o, const Vector3d& d) {
+			ox[i] = o[0]; oy[i] = o[1]; oz[i] = o[2];
+			dx[i] = d[0]; dy[i] = d[1]; dz[i] = d[2];
+			t[i] = 1e300;
+			triangle[i] = -1;
+		}
+};
+
+typedef RayPacket<4> RayPacket4;
+typedef RayPacket<8> RayPacket8;
+
+
+/// Kamera fuer die LOD-Auswahl der Kugeln
+struct BVTView
+{
+		/// Welt- -> Augkoordinaten (Blick entlang -z), darf gleichmaessig skalieren
+		Matrix4d modelview;
+
+		/// Pixel pro Einheit im Abstand 1: halbe Bildhoehe / tan(fovy/2)
+		double focal;
+
+		/// halbe Oeffnungswinkel als Tangens
+		double tan_x, tan_y;
+
+		/// gezeichnete Kugeln sind auf dem Bild hoechstens so gross (Radius in Pixeln)
+		double max_pixels;
+};
+
+
+/// Bau-Parameter
+struct BVTOptions
+{
+		enum Strategy {
+			/// Ebene durch den Schwerpunkt senkrecht zur Hauptachse (Vorlesung)
+			PCA_PLANE,
+			/// Objekt-Median entlang der laengsten Achse der AABB
+			MEDIAN,
+			/// Surface Area Heuristic, 16 Bins pro Koordinatenachse
+			SAH
+		};
+
+		Strategy strategy;
+
+		/// maximale Anzahl Punkte in einem Blatt
+		int leaf_size;
+
+		/// maximale Tiefe, tiefere Knoten werden zu Blaettern
+		int max_depth;
+
+		/// ab dieser Punktanzahl werden Teilbaeume und Reduktionen
+		/// als OpenMP-Tasks verteilt
+		int task_size;
+
+		BVTOptions (Strategy s = PCA_PLANE);
+};
+
+/// Kennzahlen eines fertigen Baums
+struct BVTStats
+{
+		int nodes;
+		int leaves;
+		int depth;
+		double avg_leaf_size;
+		/// Kugeloberflaechen relativ zur Wurzel, innere Knoten einfach, Blaetter
+		/// mit ihrer Punktanzahl gewichtet: erwartete Kosten einer zufaelligen Anfrage
+		double sah_cost;
+};
+
+/// Huellkugelbaum ohne Pointer
+/** Alle Knoten liegen in einem Array in Tiefensuch-Reihenfolge (preorder),
+		das linke Kind von Knoten i ist immer i+1. Die Punkte liegen nur einmal
+		in einem gemeinsamen, nach Blaettern umsortierten Puffer, jeder Knoten
+		verweist auf seinen Bereich darin. Speicher: O(n) statt O(n log n).
 */
 class BVT
 {
 
 	private:
 
-		const std::vector<Vector3d> points_;
+		/// points, reordered so that every node covers a contiguous range
+		const Vector3d * points_;
 
-		/// mass center of point set
-		Vector3d mass_center_;
+		/// points_[i] == input[index_[i]]
+		const int * index_;
 
-		/// inetria matrix of point set
-		Matrix4d inertia_;
-	
-		/// smallest enclosing sphere of point set	
-		const Sphere ball_;
-	
-		BVT * left_;
-		BVT * right_;
+		/// all nodes, depth first
+		const BVTNode * nodes_;
+
+		int nr_of_points_;
+		int nr_of_nodes_;
+
+		/// Speicher hinter points_, index_ und nodes_, solange sie nicht aus
+		/// file_ gelesen werden
+		std::vector<Vector3d> own_points_;
+		std::vector<int> own_index_;
+		std::vector<BVTNode> own_nodes_;
+
+		/// eingeblendete Cache-Datei, aus der gelesen wird (gehoert dem Baum), sonst NULL
+		BVTFile * file_;
+
+		/// points_, index_, nodes_ auf den eigenen Speicher setzen
+		void attach ();
+
+		/// vor dem ersten Veraendern: Daten aus file_ in den eigenen Speicher kopieren
+		void detach ();
+
+		/// nicht kopierbar, die Zeiger verweisen in den eigenen Speicher
+		BVT (const BVT&);
+		BVT& operator= (const BVT&);
+
+		/// input while building, NULL afterwards
+		const std::vector<Vector3d> * input_;
+
+		BVTOptions options_;
+
+		/// Knoten nach Tiefe sortiert (Breitensuche) und Beginn jeder Ebene darin,
+		/// fuer refit (); wird bei Bedarf neu aufgebaut
+		std::vector<int> levels_;
+		std::vector<int> level_start_;
+
+		/// builds the subtree over index_[first .. first+count-1] into out, returns its node index
+		int build (int first, int count, int depth, std::vector<BVTNode>& out, std::vector<Vector3d>& work);
+
+		/// one recursion step: partitions index_[first .. first+count-1], returns size of the left part
+		int split (int first, int count);
+		int splitPCA (int first, int count);
+		int splitMedian (int first, int count);
+		int splitSAH (int first, int count);
+
+		/// Dreieck fuer closestPoint: Positionen der Ecken in points_, Nummer in der Eingabe
+		struct Triangle {int v[3]; int id;};
+
+		/// Dreiecke nach der Position ihrer ersten Ecke sortiert, die Dreiecke von
+		/// points_[i] sind tri_[tri_start_[i] .. tri_start_[i+1]-1]
+		std::vector<Triangle> tri_;
+		std::vector<int> tri_start_;
+
+		/// pro Knoten eine Kugel um alle seine Dreiecke (Radius < 0: keine)
+		std::vector<Sphere> mesh_ball_;
+
+		/// fills mesh_ball_
+		void updateMeshBounds ();
+
+		/// fills levels_ / level_start_
+		void computeLevels ();
+
+		/// copies the subtree of nodes_[i] into out in preorder, returns its new index
+		int relayout (int i, std::vector<BVTNode>& out) const;
 
 	public:
 
-		/// create new node
-		BVT (const std::vector<Vector3d>& points);
+		/// build the whole tree
+		BVT (const std::vector<Vector3d>& points, const BVTOptions& options = BVTOptions ());
+
+		/// Baum aus einer gueltigen Cache-Datei: Anfragen lesen direkt aus der
+		/// Abbildung, erst refit () oder rotate () kopieren sie. Der Baum
+		/// uebernimmt file und gibt es im Destruktor frei.
+		explicit BVT (BVTFile * file);
+
+		~BVT ();
+
+		/// root node index
+		int root () const {return 0;};
+
+		/// get node
+		const BVTNode& node (int i) const {return nodes_[i];};
+
+		/// get children (-1 for leaves)
+		int left (int i) const {return nodes_[i].left;};
+		int right (int i) const {return nodes_[i].right;};
+
+		/// get sphere of the root / of node i
+		const Sphere& ball () const {return nodes_[0].ball;};
+		const Sphere& ball (int i) const {return nodes_[i].ball;};
+
+		/// reordered point buffer and its permutation into the input
+		const Vector3d * points () const {return points_;};
+		const int * permutation () const {return index_;};
+
+		/// anzahl der Punkte und Knoten
+		int nr_of_points () const {return nr_of_points_;};
+		int nr_of_nodes () const {return nr_of_nodes_;};
+
+		/// Parameter, mit denen der Baum gebaut wurde
+		const BVTOptions& options () const {return options_;};
+
+		/// Kennzahlen des Baums
+		BVTStats statistics () const;
+
+		/// alle Blaetter, deren Kugel und Vorfahren-Kugeln die Kugel s schneiden
+		/// (also alle Blaetter mit moeglichen Punkten in s),
+		/// liefert die Anzahl der besuchten Knoten
+		int overlap (const Sphere& s, std::vector<int>& leaves) const;
+
+		/// Paare (Blatt hier, Blatt in other), deren Kugeln sich bis auf tolerance
+		/// beruehren, wenn other mit der starren Transformation T (other -> hier)
+		/// bewegt wird. Gleichzeitiger Abstieg in beiden Baeumen ohne Rekursion,
+		/// first_hit bricht beim ersten Paar ab. Liefert die Anzahl besuchter Knotenpaare.
+		int overlap (const BVT& other, const Matrix4d& T, std::vector<std::pair<int,int> >& pairs,
+								 bool first_hit = false, double tolerance = 0.0) const;
+
+		/// Dreiecke (Indextripel in die Eingabepunkte) fuer closestPoint anhaengen
+		void setMesh (const std::vector<int>& indices);
+
+		/// die k naechsten Punkte zu q (Eingabe-Indizes, aufsteigend nach Abstand),
+		/// best-first mit Prioritaetswarteschlange ueber die Kugel-Abstaende
+		void nearest (const Vector3d& q, int k, std::vector<int>& result, std::vector<double>* dist = NULL) const;
+
+		/// alle Punkte (Eingabe-Indizes) mit Abstand <= r zu q
+		void within (const Vector3d& q, double r, std::vector<int>& result) const;
+
+		/// naechster Punkt auf dem Netz (ohne Netz: naechster Punkt), liefert den Abstand;
+		/// triangle erhaelt die Dreiecksnummer (-1 ohne Netz)
+		double closestPoint (const Vector3d& q, Vector3d& point, int* triangle = NULL) const;
+
+		/// erster Schnitt des Strahls o+t*d (0 < t < tmax) mit dem Netz aus setMesh (),
+		/// liefert t oder -1. Abstieg ueber die Dreieckskugeln (vorne zuerst),
+		/// wasserdichter Dreieckstest nach Woop, Benthin und Wald (2013)
+		double intersect (const Vector3d& o, const Vector3d& d, int* triangle = NULL, double tmax = 1e300) const;
+
+		/// dasselbe fuer ein Paket von 4 oder 8 Strahlen, die den Baum gemeinsam durchlaufen
+		template<int W>
+		void intersect (RayPacket<W>& packet) const;
 
-		/// get children
-		BVT * left() {return left_;};
-		BVT * right() {return right_;};
+		/// viele Anfragen parallel: result[i*k .. i*k+k-1], -1 falls weniger als k Punkte
+		void nearest (const std::vector<Vector3d>& q, int k, std::vector<int>& result) const;
+		void closestPoint (const std::vector<Vector3d>& q, std::vector<Vector3d>& point, std::vector<double>& dist) const;
 
-		/// one recursion step to create left and right child
-		void split ();
+		/// Knoten fuer die Darstellung: von der Wurzel absteigen, bis die Kugel auf
+		/// dem Bild hoechstens view.max_pixels gross ist oder ein Blatt erreicht ist;
+		/// Kugeln ausserhalb des Sichtkegels fallen weg. Liefert die Anzahl besuchter Knoten
+		int selectLOD (const BVTView& view, std::vector<int>& nodes) const;
 
-		/// get sphere
-		const Sphere& ball() {return ball_;};
+		/// Punkte haben sich bewegt (Reihenfolge wie beim Bau): Kugeln von unten
+		/// nach oben neu berechnen, Ebene fuer Ebene parallel. Blaetter exakt
+		/// (Welzl) oder nach Ritter, innere Knoten umschliessen ihre Kinder.
+		/// Liefert false und aendert nichts, wenn points nicht so viele Punkte
+		/// wie der Baum hat.
+		bool refit (const std::vector<Vector3d>& points, bool exact_leaves = true);
 
-		/// anzahl der Punkte
-		int nr_of_points () {return points_.size ();};
+		/// ein Durchlauf Baumrotationen (Kinder und Enkel tauschen, die
+		/// Punktreihenfolge bleibt), wo die Kugeloberflaeche kleiner wird;
+		/// liefert die Anzahl der Rotationen
+		int rotate ();
 	
 };
 
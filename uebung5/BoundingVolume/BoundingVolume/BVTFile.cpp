@@ -0,0 +1,218 @@
+#include "BVTFile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char MAGIC[8] = {'B','V','T','C','A','C','H','E'};
+const unsigned int VERSION = 1;
+
+/// Dateikopf, danach Knoten, Punkte und Permutation, jeweils auf 8 Byte ausgerichtet
+struct Header
+{
+	char magic[8];
+	unsigned int version;
+	/// Groessen der Eintraege, damit andere Compiler/Layouts abgelehnt werden
+	unsigned int node_size;
+	unsigned int point_size;
+	int strategy;
+	int leaf_size;
+	int max_depth;
+	int task_size;
+	int nr_of_nodes;
+	int nr_of_points;
+	int reserved;
+	unsigned long long hash;
+};
+
+inline size_t align8 (size_t n) {return (n+7) & ~size_t (7);}
+
+}
+
+BVTFile::BVTFile (const char * filename, unsigned long long hash)
+: data_ (NULL), size_ (0), mapped_ (false), nodes_ (NULL), points_ (NULL), index_ (NULL), nr_of_nodes_ (0), nr_of_points_ (0)
+{
+#ifndef _WIN32
+	int fd = open (filename,O_RDONLY);
+	if (fd < 0) return;
+	struct stat st;
+	if (fstat (fd,&st) == 0 && st.st_size >= (off_t)sizeof (Header)) {
+		void * p = mmap (NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+		if (p != MAP_FAILED) {
+			data_ = (char *)p;
+			size_ = st.st_size;
+			mapped_ = true;
+		}
+	}
+	::close (fd);
+#else
+	FILE * f = fopen (filename,"rb");
+	if (!f) return;
+	fseek (f,0,SEEK_END);
+	long n = ftell (f);
+	fseek (f,0,SEEK_SET);
+	if (n >= (long)sizeof (Header)) {
+		data_ = (char *)malloc (n);
+		if (data_ && fread (data_,1,n,f) == size_t (n))
+			size_ = n;
+		else
+			close ();
+	}
+	fclose (f);
+#endif
+	if (!data_) return;
+
+	const Header& h = *(const Header *)data_;
+	size_t nodes_bytes = align8 (size_t (h.nr_of_nodes)*sizeof (BVTNode));
+	size_t points_bytes = align8 (size_t (h.nr_of_points)*sizeof (Vector3d));
+	size_t index_bytes = align8 (size_t (h.nr_of_points)*sizeof (int));
+	if (memcmp (h.magic,MAGIC,8) != 0 || h.version != VERSION || h.hash != hash
+			|| h.node_size != sizeof (BVTNode) || h.point_size != sizeof (Vector3d)
+			|| h.nr_of_nodes < 1 || h.nr_of_points < 0
+			|| size_ != align8 (sizeof (Header))+nodes_bytes+points_bytes+index_bytes) {
+		close ();
+		return;
+	}
+
+	options_.strategy = BVTOptions::Strategy (h.strategy);
+	options_.leaf_size = h.leaf_size;
+	options_.max_depth = h.max_depth;
+	options_.task_size = h.task_size;
+	nr_of_nodes_ = h.nr_of_nodes;
+	nr_of_points_ = h.nr_of_points;
+
+	const char * p = data_+align8 (sizeof (Header));
+	nodes_ = (const BVTNode *)p;
+	points_ = (const Vector3d *)(p+nodes_bytes);
+	index_ = (const int *)(p+nodes_bytes+points_bytes);
+
+	if (!consistent ())
+		close ();
+}
+
+bool BVTFile::consistent () const
+{
+	/// Kinder liegen hinter den Eltern (wie nach Bau und rotate ()), dann gibt
+	/// es keine Zyklen; jeder Punktbereich liegt im Punkt-Array
+	for(int i=0;i<nr_of_nodes_;i++) {
+		const BVTNode& n = nodes_[i];
+		if (n.first < 0 || n.count < 0 || n.first > nr_of_points_-n.count)
+			return false;
+		if (n.leaf ())
+			continue;
+		if (n.left <= i || n.left >= nr_of_nodes_ || n.right <= i || n.right >= nr_of_nodes_)
+			return false;
+	}
+	for(int i=0;i<nr_of_points_;i++)
+		if (index_[i] < 0 || index_[i] >= nr_of_points_)
+			return false;
+	return true;
+}
+
+BVTFile::~BVTFile ()
+{
+	close ();
+}
+
+void BVTFile::close ()
+{
+	if (data_) {
+#ifndef _WIN32
+		if (mapped_)
+			munmap (data_,size_);
+		else
+#endif
+			free (data_);
+	}
+	data_ = NULL;
+	size_ = 0;
+	nodes_ = NULL;
+	points_ = NULL;
+	index_ = NULL;
+	nr_of_nodes_ = nr_of_points_ = 0;
+}
+
+bool BVTFile::write (const char * filename, const BVT& tree, unsigned long long hash)
+{
+	if (tree.nr_of_nodes () < 1) return false;
+
+	Header h;
+	memset (&h,0,sizeof (h));
+	memcpy (h.magic,MAGIC,8);
+	h.version = VERSION;
+	h.node_size = sizeof (BVTNode);
+	h.point_size = sizeof (Vector3d);
+	h.strategy = tree.options ().strategy;
+	h.leaf_size = tree.options ().leaf_size;
+	h.max_depth = tree.options ().max_depth;
+	h.task_size = tree.options ().task_size;
+	h.nr_of_nodes = tree.nr_of_nodes ();
+	h.nr_of_points = tree.nr_of_points ();
+	h.hash = hash;
+
+	/// erst in eine temporaere Datei, dann umbenennen: Leser sehen nie eine halbe Datei
+	std::string tmp = std::string (filename)+".tmp";
+	FILE * f = fopen (tmp.c_str (),"wb");
+	if (!f) return false;
+
+	static const char zeros[8] = {0,0,0,0,0,0,0,0};
+	size_t nodes_bytes = size_t (h.nr_of_nodes)*sizeof (BVTNode);
+	size_t points_bytes = size_t (h.nr_of_points)*sizeof (Vector3d);
+	size_t index_bytes = size_t (h.nr_of_points)*sizeof (int);
+	bool ok = fwrite (&h,sizeof (h),1,f) == 1
+		&& fwrite (zeros,1,align8 (sizeof (h))-sizeof (h),f) == align8 (sizeof (h))-sizeof (h)
+		&& fwrite (&tree.node (0),1,nodes_bytes,f) == nodes_bytes
+		&& fwrite (zeros,1,align8 (nodes_bytes)-nodes_bytes,f) == align8 (nodes_bytes)-nodes_bytes;
+	if (ok && h.nr_of_points > 0)
+		ok = fwrite (&tree.points ()[0],1,points_bytes,f) == points_bytes
+			&& fwrite (zeros,1,align8 (points_bytes)-points_bytes,f) == align8 (points_bytes)-points_bytes
+			&& fwrite (&tree.permutation ()[0],1,index_bytes,f) == index_bytes
+			&& fwrite (zeros,1,align8 (index_bytes)-index_bytes,f) == align8 (index_bytes)-index_bytes;
+	ok = (fclose (f) == 0) && ok;
+
+	if (ok) {
+#ifdef _WIN32
+		remove (filename);
+#endif
+		ok = rename (tmp.c_str (),filename) == 0;
+	}
+	if (!ok)
+		remove (tmp.c_str ());
+	return ok;
+}
+
+unsigned long long BVTFile::hash (const std::vector<Vector3d>& points, const std::vector<int>& indices,
+																	const BVTOptions& options)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	const unsigned char * p = points.empty () ? NULL : (const unsigned char *)&points[0];
+	size_t n = points.size ()*sizeof (Vector3d);
+	for(size_t i=0;i<n;i++) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	p = indices.empty () ? NULL : (const unsigned char *)&indices[0];
+	n = indices.size ()*sizeof (int);
+	for(size_t i=0;i<n;i++) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	/// task_size aendert den Baum nicht, nur die Verteilung auf Threads
+	int o[3] = {options.strategy,options.leaf_size,options.max_depth};
+	p = (const unsigned char *)o;
+	for(size_t i=0;i<sizeof (o);i++) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
@@ -0,0 +1,68 @@
+#ifndef BVTFILE_H
+#define BVTFILE_H
+
+#include <vector>
+#include "vecmath.h"
+#include "BVT.h"
+
+/// Ein auf der Platte abgelegter BVT, read-only per mmap eingeblendet.
+/** Die Datei enthaelt den flachen Baum (Knoten mit Kugeln, umsortierte
+		Punkte, Permutation) und den Inhalts-Hash des Modells, aus dem er
+		gebaut wurde, und die Bau-Parameter. Passt der Hash nicht, ist die Datei
+		ungueltig und der Baum muss neu gebaut werden. BVT (BVTFile *) liest
+		direkt aus der Abbildung. Mehrere Prozesse teilen sich die Seiten
+		ueber den Page-Cache; ohne POSIX wird die Datei eingelesen.
+*/
+class BVTFile
+{
+	public:
+
+		/// oeffnen und pruefen, valid () sagt ob es geklappt hat
+		BVTFile (const char * filename, unsigned long long hash);
+		~BVTFile ();
+
+		bool valid () const {return data_ != NULL;};
+
+		/// Baumdaten direkt aus der Datei
+		const BVTNode * nodes () const {return nodes_;};
+		const Vector3d * points () const {return points_;};
+		const int * permutation () const {return index_;};
+		int nr_of_nodes () const {return nr_of_nodes_;};
+		int nr_of_points () const {return nr_of_points_;};
+		const BVTOptions& options () const {return options_;};
+
+		/// Wurzelkugel
+		const Sphere& ball () const {return nodes_[0].ball;};
+
+		/// Baum mit Hash in eine Datei schreiben
+		static bool write (const char * filename, const BVT& tree, unsigned long long hash);
+
+		/// FNV-1a ueber Punkte, Dreiecksindizes und die Bau-Parameter
+		static unsigned long long hash (const std::vector<Vector3d>& points, const std::vector<int>& indices,
+																		const BVTOptions& options);
+
+	private:
+
+		/// nicht kopierbar, die Abbildung gehoert genau einem Objekt
+		BVTFile (const BVTFile&);
+		BVTFile& operator= (const BVTFile&);
+
+		void close ();
+
+		/// Kinder-Indizes, Punktbereiche und Permutation liegen in den Arrays
+		bool consistent () const;
+
+		/// eingeblendete (oder eingelesene) Datei
+		char * data_;
+		size_t size_;
+		bool mapped_;
+
+		const BVTNode * nodes_;
+		const Vector3d * points_;
+		const int * index_;
+		int nr_of_nodes_;
+		int nr_of_points_;
+		BVTOptions options_;
+};
+
+#endif //BVTFILE_H
@@ -7,13 +7,20 @@
 #include <QKeyEvent>
 #include <QMessageBox>
 #include <QHBoxLayout>
+#include <QElapsedTimer>
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <limits>
+#include <cstdlib>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "Sphere.h"
 #include "BoundingVolume.h"
@@ -21,6 +28,8 @@
 #include "OffReader.h"
 
 #include "BVT.h"
+#include "BVTFile.h"
+#include "CompactBVT.h"
 
 const int numpoints = 100;
 static std::vector<Vector3d> point;
@@ -72,6 +81,7 @@ CGView::CGView (CGMainWindow *mainwindow,QWidget* parent ) : QGLWidget (parent),
 	main = mainwindow;
 
 	show_circle=true;
+	lod_pixels = 20.0;
 	bbox_on = true;
 
   Vector3d c = Vector3d(0.0,0.0,0.0);
@@ -104,10 +114,57 @@ void CGView::initializeGL() {
 }
 
 
-/// Rekursiver abstieg bis in Tiefe deep zum malen des Huellkoerpers
+/// Abstieg bis die Kugeln auf dem Bild hoechstens lod_pixels gross sind,
+/// alle ausgewaehlten Kugeln gehen in einem einzigen Draw-Call raus
 void CGView::drawBall (BVT * tree)
 {
-	tree->ball().draw();
+	/// Kamera aus den aktuellen GL-Matrizen (gluPerspective mit 45 Grad in resizeGL)
+	GLdouble M[16];
+	GLint viewport[4];
+	glGetDoublev (GL_MODELVIEW_MATRIX,M);
+	glGetIntegerv (GL_VIEWPORT,viewport);
+	BVTView view;
+	view.modelview = Matrix4d (M).transpose ();
+	view.tan_y = tan (22.5*M_PI/180.0);
+	view.tan_x = view.tan_y*viewport[2]/double (viewport[3]);
+	view.focal = 0.5*viewport[3]/view.tan_y;
+	view.max_pixels = lod_pixels;
+
+	std::vector<int> nodes;
+	int visited = tree->selectLOD (view,nodes);
+
+	/// Einheitskugel als drei Grosskreise (Linienpaare)
+	const int segments = 24;
+	static std::vector<Vector3d> unit;
+	if (unit.empty ())
+		for(int k=0;k<3;k++)
+			for(int j=0;j<segments;j++)
+				for(int e=0;e<2;e++) {
+					double a = 2.0*M_PI*(j+e)/segments;
+					Vector3d v;
+					v[k] = cos (a);
+					v[(k+1)%3] = sin (a);
+					unit.push_back (v);
+				}
+
+	static std::vector<Vector3d> lines;
+	lines.resize (nodes.size ()*unit.size ());
+	for(unsigned int i=0;i<nodes.size ();i++) {
+		const Sphere& s = tree->ball (nodes[i]);
+		for(unsigned int j=0;j<unit.size ();j++)
+			lines[i*unit.size ()+j] = s.center + unit[j]*s.radius;
+	}
+
+	glColor3d (0.7,0.6,0.7);
+	if (!lines.empty ()) {
+		glEnableClientState (GL_VERTEX_ARRAY);
+		glVertexPointer (3,GL_DOUBLE,0,lines[0].ptr ());
+		glDrawArrays (GL_LINES,0,GLsizei (lines.size ()));
+		glDisableClientState (GL_VERTEX_ARRAY);
+	}
+
+	main->statusBar()->showMessage (QString ("LOD %1 px: %2 spheres drawn, %3 of %4 nodes visited")
+		.arg (lod_pixels).arg (nodes.size ()).arg (visited).arg (tree->nr_of_nodes ()));
 }
 
 /// Draws the off file scaled and fitting into the scene
@@ -204,6 +261,19 @@ void CGView::worldCoord(int x, int y, int z, Vector3d &v) {
 void CGView::mousePressEvent(QMouseEvent *event) {
 	oldX = event->x();
 	oldY = event->y();
+
+	/// Strg+Klick: Strahl durch das Pixel, die Testkugel springt auf den Treffer
+	if (event->modifiers() & Qt::ControlModifier) {
+		makeCurrent ();
+		Vector3d p0, p1;
+		worldCoord (oldX,oldY,0,p0);
+		worldCoord (oldX,oldY,1,p1);
+		double t = root->intersect (p0,p1-p0);
+		if (t > 0.0) {
+			test_kugel.center = p0 + (p1-p0)*t;
+			updateGL ();
+		}
+	}
 }
 
 void CGView::mouseReleaseEvent(QMouseEvent*) {}
@@ -249,6 +319,20 @@ void CGView::mouseMoveEvent(QMouseEvent* event) {
 	updateGL();
 }
 
+/// verdrillt das Modell um die z-Achse durch den Mittelpunkt (Winkel waechst mit z)
+/// und passt den Baum per refit an, statt ihn neu zu bauen
+static void twistPoints (double angle) {
+	Vector3d c = root->ball().center;
+	double r = root->ball().radius;
+	for(unsigned int i=0;i<point.size();i++) {
+		Vector3d d = point[i]-c;
+		double a = angle*d[2]/r;
+		point[i] = c + Vector3d (cos(a)*d[0]-sin(a)*d[1], sin(a)*d[0]+cos(a)*d[1], d[2]);
+	}
+	root->refit (point);
+	root->rotate ();
+}
+
 void CGView::keyPressEvent( QKeyEvent * event) 
 {
 	bool changed = true;
@@ -258,13 +342,301 @@ void CGView::keyPressEvent( QKeyEvent * event)
 		case Qt::Key_X     : if (event->modifiers() & Qt::ShiftModifier) test_kugel.center[0] -= 0.05; else test_kugel.center[0] += 0.05; break;
 		case Qt::Key_Y     : if (event->modifiers() & Qt::ShiftModifier) test_kugel.center[1] -= 0.05; else test_kugel.center[1] += 0.05; break;
 		case Qt::Key_Z     : if (event->modifiers() & Qt::ShiftModifier) test_kugel.center[2] -= 0.05; else test_kugel.center[2] += 0.05; break;
+		case Qt::Key_Plus  : lod_pixels *= 1.5; break;
+		case Qt::Key_Minus : lod_pixels = std::max (1.0,lod_pixels/1.5); break;
+		case Qt::Key_T     : if (event->modifiers() & Qt::ShiftModifier) twistPoints (-0.1); else twistPoints (0.1); break;
 		default: changed=false; break;
 	}
 		
 	updateGL();
 }
 
+/// Bauzeit, Baumkennzahlen und Anfragezeit fuer jede Split-Strategie
+static void printBVTStats (const std::vector<Vector3d>& points, const std::vector<int>& mesh) {
+	const char* names[3] = {"PCA plane","object median","SAH"};
+	for(int s=0;s<3;s++) {
+		QElapsedTimer timer;
+		timer.start ();
+		BVT tree (points,BVTOptions (BVTOptions::Strategy (s)));
+		qint64 build_ms = timer.elapsed ();
+		BVTStats st = tree.statistics ();
+
+		/// 1000 Anfragekugeln um zufaellige Punkte, Radius 5% der Wurzel
+		std::vector<int> leaves;
+		long visited = 0, hits = 0;
+		double r = 0.05*tree.ball ().radius;
+		Sphere q;
+		q.radius = r;
+		srand (1);
+		timer.restart ();
+		for(int i=0;i<1000;i++) {
+			q.center = points[rand ()%points.size ()];
+			visited += tree.overlap (q,leaves);
+			hits += leaves.size ();
+		}
+		qint64 query_ms = timer.elapsed ();
+
+		std::cout << names[s] << ": build " << build_ms << " ms, " << st.nodes << " nodes, " << st.leaves << " leaves, depth " << st.depth
+		          << ", avg leaf " << st.avg_leaf_size << ", SAH cost " << st.sah_cost
+		          << " | 1000 queries " << query_ms << " ms, " << visited/1000.0 << " nodes visited, " << hits/1000.0 << " leaves hit" << std::endl;
+	}
+
+	/// Kontakttest des Modells mit einer gedrehten und verschobenen Kopie
+	{
+		BVT tree (points);
+		Matrix4d T (Quat4d (0.3,Vector3d (0,0,1)));
+		Matrix4d shift;
+		shift.makeTranslate (Vector3d (tree.ball ().radius,0,0));
+		T = shift*T;
+
+		std::vector<std::pair<int,int> > pairs;
+		QElapsedTimer timer;
+		timer.start ();
+		int visited = tree.overlap (tree,T,pairs);
+		qint64 all_ns = timer.nsecsElapsed ();
+		int leaf_pairs = int (pairs.size ());
+		timer.restart ();
+		int first_visited = tree.overlap (tree,T,pairs,true);
+		qint64 first_ns = timer.nsecsElapsed ();
+		std::cout << "BVT vs BVT: " << leaf_pairs << " leaf pairs, " << visited << " node pairs, " << all_ns/1000 << " us"
+		          << " | first hit: " << first_visited << " node pairs, " << first_ns/1000 << " us" << std::endl;
+	}
+
+	/// Abstandsanfragen fuer 10000 zufaellige Punkte um das Modell, parallel
+	{
+		BVT tree (points);
+		tree.setMesh (mesh);
+		double r = tree.ball ().radius;
+		std::vector<Vector3d> q (10000);
+		srand (2);
+		for(unsigned int i=0;i<q.size ();i++)
+			q[i] = tree.ball ().center + Vector3d (rand ()/double (RAND_MAX)-0.5, rand ()/double (RAND_MAX)-0.5, rand ()/double (RAND_MAX)-0.5)*(2.0*r);
+
+		std::vector<Vector3d> closest;
+		std::vector<double> dist;
+		std::vector<int> knn;
+		QElapsedTimer timer;
+		timer.start ();
+		tree.closestPoint (q,closest,dist);
+		qint64 closest_ms = timer.elapsed ();
+		timer.restart ();
+		tree.nearest (q,8,knn);
+		qint64 knn_ms = timer.elapsed ();
+		std::cout << "10000 queries: closest point on mesh " << closest_ms << " ms, 8 nearest points " << knn_ms << " ms" << std::endl;
+	}
+
+	/// Strahlen: 512x512 Pixel von einer Kamera ausserhalb der Huellkugel
+	{
+		BVT tree (points);
+		tree.setMesh (mesh);
+		const int N = 512;
+		double r = tree.ball ().radius;
+		Vector3d eye = tree.ball ().center + Vector3d (0.1*r,0.2*r,3.0*r);
+		std::vector<Vector3d> dir (N*N);
+		for(int y=0;y<N;y++)
+			for(int x=0;x<N;x++)
+				dir[y*N+x] = tree.ball ().center + Vector3d ((2.0*x/N-1.0)*r,(2.0*y/N-1.0)*r,0.0) - eye;
+
+		QElapsedTimer timer;
+		int hits1 = 0, hits4 = 0, hits8 = 0;
+		timer.start ();
+#pragma omp parallel for reduction(+:hits1) schedule(dynamic,256)
+		for(int i=0;i<N*N;i++)
+			if (tree.intersect (eye,dir[i]) > 0.0) hits1++;
+		qint64 single_ns = timer.nsecsElapsed ();
+
+		timer.restart ();
+#pragma omp parallel for reduction(+:hits4) schedule(dynamic,64)
+		for(int i=0;i<N*N;i+=4) {
+			RayPacket4 packet;
+			for(int j=0;j<4;j++) packet.set (j,eye,dir[i+j]);
+			tree.intersect (packet);
+			for(int j=0;j<4;j++) if (packet.triangle[j] >= 0) hits4++;
+		}
+		qint64 packet4_ns = timer.nsecsElapsed ();
+
+		timer.restart ();
+#pragma omp parallel for reduction(+:hits8) schedule(dynamic,32)
+		for(int i=0;i<N*N;i+=8) {
+			RayPacket8 packet;
+			for(int j=0;j<8;j++) packet.set (j,eye,dir[i+j]);
+			tree.intersect (packet);
+			for(int j=0;j<8;j++) if (packet.triangle[j] >= 0) hits8++;
+		}
+		qint64 packet8_ns = timer.nsecsElapsed ();
+
+		double rays = double (N)*N*1000.0;
+		std::cout << "rays: single " << rays/(single_ns+1) << " Mrays/s, 4-packets " << rays/(packet4_ns+1)
+		          << " Mrays/s, 8-packets " << rays/(packet8_ns+1) << " Mrays/s (" << hits1 << "/" << hits4 << "/" << hits8 << " hits)" << std::endl;
+	}
+
+	/// kompakter BVH4 gegen den Binaerbaum: Radiussuche um 10000 Modellpunkte
+	{
+		BVT tree (points);
+		QElapsedTimer timer;
+		timer.start ();
+		CompactBVT compact (tree);
+		qint64 convert_ms = timer.elapsed ();
+
+		double r = 0.02*tree.ball ().radius;
+		std::vector<Vector3d> q (10000);
+		srand (3);
+		for(unsigned int i=0;i<q.size ();i++)
+			q[i] = points[rand ()%points.size ()];
+
+		std::vector<int> found, leaves;
+		long tree_visited = 0, compact_visited = 0;
+		Sphere s;
+		s.radius = r;
+		for(unsigned int i=0;i<q.size ();i++) {
+			s.center = q[i];
+			tree_visited += tree.overlap (s,leaves);
+		}
+		timer.restart ();
+		for(unsigned int i=0;i<q.size ();i++)
+			tree.within (q[i],r,found);
+		qint64 tree_ns = timer.nsecsElapsed ();
+		timer.restart ();
+		for(unsigned int i=0;i<q.size ();i++)
+			compact_visited += compact.within (q[i],r,found);
+		qint64 compact_ns = timer.nsecsElapsed ();
+
+		std::cout << "BVH4: " << compact.nr_of_nodes () << " nodes, " << compact.memory ()/1024 << " KB (binary " << tree.nr_of_nodes ()*sizeof (BVTNode)/1024
+		          << " KB), conversion " << convert_ms << " ms | node bytes per query " << tree_visited*sizeof (BVTNode)/q.size ()
+		          << " vs " << compact_visited*sizeof (BVH4Node)/q.size () << ", " << tree_ns/q.size () << " ns vs " << compact_ns/q.size () << " ns" << std::endl;
+	}
+
+#ifdef _OPENMP
+	/// Skalierung des Baus mit der Anzahl der Threads
+	int max_threads = omp_get_max_threads ();
+	qint64 serial_ms = 0;
+	for(int t=1;t<=max_threads;t = (t < max_threads && 2*t > max_threads) ? max_threads : 2*t) {
+		omp_set_num_threads (t);
+		QElapsedTimer timer;
+		timer.start ();
+		BVT tree (points);
+		qint64 ms = timer.elapsed ();
+		if (t == 1) serial_ms = ms;
+		std::cout << t << " threads: build " << ms << " ms, speedup " << (ms > 0 ? double (serial_ms)/ms : 1.0) << std::endl;
+	}
+	omp_set_num_threads (max_threads);
+#endif
+}
+
+/// alter Weg ueber Matrix4d::inverse, Referenz fuer Sphere::circumcenter
+static Vector3d circumcenterMatrix (const Vector3d& a, const Vector3d& b, const Vector3d& c) {
+	Vector3d ba = b-a, ca = c-a, n = ba%ca;
+	Matrix4d T (ba[0],ba[1],ba[2],0.0,
+							ca[0],ca[1],ca[2],0.0,
+							n[0], n[1], n[2], 0.0,
+							0.0,  0.0,  0.0,  1.0);
+	Vector3d r (0.5*ba.lengthSquared (),0.5*ca.lengthSquared (),0.0);
+	return Matrix4d::inverse (T)*r + a;
+}
+
+static Vector3d circumcenterMatrix (const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d) {
+	Vector3d ba = b-a, ca = c-a, da = d-a;
+	Matrix4d T (ba[0],ba[1],ba[2],0.0,
+							ca[0],ca[1],ca[2],0.0,
+							da[0],da[1],da[2],0.0,
+							0.0,  0.0,  0.0,  1.0);
+	Vector3d r (0.5*ba.lengthSquared (),0.5*ca.lengthSquared (),0.5*da.lengthSquared ());
+	return Matrix4d::inverse (T)*r + a;
+}
+
+static double uniform (double a, double b) {
+	return a+(b-a)*rand ()/double (RAND_MAX);
+}
+
+static Vector3d randomPoint () {
+	return Vector3d (uniform (-1,1),uniform (-1,1),uniform (-1,1));
+}
+
+/// groesste Abweichung |m-p_j|-r relativ zu r ueber die k Punkte
+static double circumResidual (const Vector3d& m, const Vector3d* q, int k) {
+	double r = (m-q[0]).length ();
+	double res = 0.0;
+	for(int j=1;j<k;j++)
+		res = std::max (res,fabs ((m-q[j]).length ()-r)/r);
+	return res;
+}
+
+/// nimmt die Ergebnisse der Zeitmessung auf, damit der Compiler die Schleifen nicht streicht
+static volatile double circum_sink;
+
+/// Sphere::circumcenter gegen den alten Weg ueber Matrix4d::inverse, auf
+/// zufaelligen Dreiecken/Tetraedern und solchen, deren letzter Punkt bis auf
+/// eps auf der Geraden/Ebene der anderen liegt: als entartet erkannte Faelle,
+/// Abstand der beiden Mittelpunkte und Abweichung vom Umkugelradius (jeweils
+/// relativ zum Radius) sowie Zeit pro Aufruf
+static void printCircumcenterCheck () {
+	const int N = 100000;
+	const double eps[5] = {0.0,1e-3,1e-6,1e-9,1e-12};
+	srand (1);
+	for(int k=3;k<=4;k++) {
+		for(int e=0;e<5;e++) {
+			std::vector<Vector3d> p (k*N);
+			for(int i=0;i<N;i++) {
+				Vector3d* q = &p[k*i];
+				for(int j=0;j<k;j++)
+					q[j] = randomPoint ();
+				if (e == 0) continue;
+				Vector3d on = q[0] + (q[1]-q[0])*uniform (0,1);
+				if (k == 4)
+					on += (q[2]-q[0])*uniform (0,1);
+				q[k-1] = on + randomPoint ()*eps[e];
+			}
+
+			int degenerate = 0;
+			double diff = 0.0, res_new = 0.0, res_old = 0.0;
+			for(int i=0;i<N;i++) {
+				const Vector3d* q = &p[k*i];
+				Vector3d m;
+				bool ok = k == 3 ? Sphere::circumcenter (q[0],q[1],q[2],m) : Sphere::circumcenter (q[0],q[1],q[2],q[3],m);
+				if (!ok) {
+					degenerate++;
+					continue;
+				}
+				Vector3d ref = k == 3 ? circumcenterMatrix (q[0],q[1],q[2]) : circumcenterMatrix (q[0],q[1],q[2],q[3]);
+				diff = std::max (diff,(m-ref).length ()/(m-q[0]).length ());
+				res_new = std::max (res_new,circumResidual (m,q,k));
+				res_old = std::max (res_old,circumResidual (ref,q,k));
+			}
+
+			QElapsedTimer timer;
+			double sum = 0.0;
+			timer.start ();
+			for(int i=0;i<N;i++) {
+				const Vector3d* q = &p[k*i];
+				Vector3d m;
+				if (k == 3) Sphere::circumcenter (q[0],q[1],q[2],m);
+				else Sphere::circumcenter (q[0],q[1],q[2],q[3],m);
+				sum += m[0];
+			}
+			double ns_new = double (timer.nsecsElapsed ())/N;
+			timer.restart ();
+			for(int i=0;i<N;i++) {
+				const Vector3d* q = &p[k*i];
+				sum += k == 3 ? circumcenterMatrix (q[0],q[1],q[2])[0] : circumcenterMatrix (q[0],q[1],q[2],q[3])[0];
+			}
+			double ns_old = double (timer.nsecsElapsed ())/N;
+			circum_sink = sum;
+
+			std::cout << (k == 3 ? "triangles " : "tetrahedra ");
+			if (e == 0) std::cout << "random"; else std::cout << "eps " << eps[e];
+			std::cout << ": degenerate " << degenerate << "/" << N
+								<< ", center diff " << diff << ", residual " << res_new << " (matrix " << res_old << ")"
+								<< ", " << ns_new << " ns/call (matrix " << ns_old << ")" << std::endl;
+		}
+	}
+}
+
 int main (int argc, char **argv) {
+	if (argc == 2 && std::string (argv[1]) == "-circum") {
+		printCircumcenterCheck ();
+		return 0;
+	}
+
 	QApplication app(argc, argv);
 
 	if (!QGLFormat::hasOpenGL()) {
@@ -272,7 +644,7 @@ int main (int argc, char **argv) {
 		return 1;
 	}
 
-	if(argc == 2)
+	if(argc >= 2)
 	{
 		LoadOffFile(argv[1], point, indices);
 	}
@@ -282,8 +654,31 @@ int main (int argc, char **argv) {
 		if (fail<0) return -1;
 	}
 
-	/// Wir bauen die Wurzel, mit allen Punkten
-	root = new BVT (point);
+	/// Wir bauen die Wurzel, mit allen Punkten - oder nehmen den Baum aus dem
+	/// Cache neben der OFF-Datei, wenn er zum Inhalt des Modells passt
+	std::string cache = std::string (argc >= 2 ? argv[1] : "space_station.off") + ".bvt";
+	unsigned long long key = BVTFile::hash (point, indices, BVTOptions ());
+	QElapsedTimer timer;
+	timer.start ();
+	{
+		/// der Baum behaelt die Datei und liest direkt aus der Abbildung
+		BVTFile * file = new BVTFile (cache.c_str (), key);
+		if (file->valid ())
+			root = new BVT (file);
+		else
+			delete file;
+	}
+	if (root)
+		std::cout << "BVT loaded from " << cache << " in " << timer.elapsed () << " ms" << std::endl;
+	else {
+		root = new BVT (point);
+		std::cout << "BVT built in " << timer.elapsed () << " ms" << std::endl;
+		BVTFile::write (cache.c_str (), *root, key);
+	}
+	root->setMesh (indices);
+
+	if (argc == 3 && std::string (argv[2]) == "-stats")
+		printBVTStats (point, indices);
 
 	/// Bauen wir die Testkugel!
 	Vector3d a = root->ball().center;
@@ -80,6 +80,9 @@ public:
 
 	unsigned int picked;
 
+	/// LOD der Kugeldarstellung: maximaler Radius einer Kugel in Pixeln
+	double lod_pixels;
+
 protected:
 	void paintGL();
 	void resizeGL(int,int);
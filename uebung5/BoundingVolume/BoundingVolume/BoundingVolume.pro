@@ -7,3 +7,5 @@ SOURCES += *.cpp
 
 macx: QMAKE_MAC_SDK = macosx10.9
 unix:!macx: LIBS+= -lGLU
+unix:!macx: QMAKE_CXXFLAGS += -fopenmp
+unix:!macx: QMAKE_LFLAGS += -fopenmp
@@ -0,0 +1,176 @@
+#include "CompactBVT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+/// Bitmaske der Kinder, deren Kugel die Anfragekugel (lx,ly,lz; rq) schneidet,
+/// alles im Bezugssystem des Knotens
+inline int overlap4 (const BVH4Node& node, float lx, float ly, float lz, float rq)
+{
+#ifdef __SSE2__
+	__m128 step = _mm_set1_ps (node.step);
+	/// 4 x int16 -> 4 x float (mit bzw. ohne Vorzeichen)
+	__m128i x = _mm_loadl_epi64 ((const __m128i *)node.cx);
+	__m128i y = _mm_loadl_epi64 ((const __m128i *)node.cy);
+	__m128i z = _mm_loadl_epi64 ((const __m128i *)node.cz);
+	__m128i r = _mm_loadl_epi64 ((const __m128i *)node.r);
+	__m128 cx = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (x,x),16));
+	__m128 cy = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (y,y),16));
+	__m128 cz = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (z,z),16));
+	__m128 cr = _mm_cvtepi32_ps (_mm_unpacklo_epi16 (r,_mm_setzero_si128 ()));
+
+	__m128 dx = _mm_sub_ps (_mm_set1_ps (lx),_mm_mul_ps (cx,step));
+	__m128 dy = _mm_sub_ps (_mm_set1_ps (ly),_mm_mul_ps (cy,step));
+	__m128 dz = _mm_sub_ps (_mm_set1_ps (lz),_mm_mul_ps (cz,step));
+	__m128 d2 = _mm_add_ps (_mm_add_ps (_mm_mul_ps (dx,dx),_mm_mul_ps (dy,dy)),_mm_mul_ps (dz,dz));
+	__m128 rr = _mm_add_ps (_mm_set1_ps (rq),_mm_mul_ps (cr,step));
+	return _mm_movemask_ps (_mm_cmple_ps (d2,_mm_mul_ps (rr,rr)));
+#else
+	int mask = 0;
+	for(int k=0;k<4;k++) {
+		float dx = lx-node.cx[k]*node.step;
+		float dy = ly-node.cy[k]*node.step;
+		float dz = lz-node.cz[k]*node.step;
+		float rr = rq+node.r[k]*node.step;
+		if (dx*dx+dy*dy+dz*dz <= rr*rr)
+			mask |= 1 << k;
+	}
+	return mask;
+#endif
+}
+
+}
+
+CompactBVT::CompactBVT (const BVT& tree)
+: nodes_ (NULL), nr_of_nodes_ (0), points_ (tree.points (),tree.points ()+tree.nr_of_points ()),
+	index_ (tree.permutation (),tree.permutation ()+tree.nr_of_points ())
+{
+	std::vector<BVH4Node> out;
+	if (tree.nr_of_nodes () > 0) {
+		ball_ = tree.ball ();
+		if (tree.node (0).leaf ())
+			addLeaf (tree.node (0));
+		else {
+			out.reserve (tree.nr_of_nodes ()/3+1);
+			convert (tree,0,out);
+		}
+	}
+
+	/// in ausgerichteten Speicher umziehen, ein Knoten = eine Cache-Zeile
+	nr_of_nodes_ = int (out.size ());
+	storage_.resize ((out.size ()+1)*sizeof (BVH4Node));
+	nodes_ = (BVH4Node *)(((size_t)&storage_[0]+63) & ~size_t (63));
+	if (!out.empty ())
+		memcpy (nodes_,&out[0],out.size ()*sizeof (BVH4Node));
+}
+
+int CompactBVT::addLeaf (const BVTNode& n)
+{
+	int k = int (leaves_.size ())/2;
+	leaves_.push_back (n.first);
+	leaves_.push_back (n.count);
+	return ~k;
+}
+
+int CompactBVT::convert (const BVT& tree, int i, std::vector<BVH4Node>& out)
+{
+	/// bis zu vier Kinder: die groesste innere Kugel wird durch ihre Kinder ersetzt
+	int c[4] = {tree.left (i),tree.right (i),-1,-1};
+	int n = 2;
+	while (n < 4) {
+		int best = -1;
+		for(int k=0;k<n;k++)
+			if (!tree.node (c[k]).leaf () && (best < 0 || tree.ball (c[k]).radius > tree.ball (c[best]).radius))
+				best = k;
+		if (best < 0) break;
+		int j = c[best];
+		c[best] = tree.left (j);
+		c[n++] = tree.right (j);
+	}
+
+	/// Bezugssystem: die Kugel von i, alle Kinderkugeln liegen darin
+	const Sphere& frame = tree.ball (i);
+	BVH4Node node;
+	for(int j=0;j<3;j++)
+		node.center[j] = float (frame.center[j]);
+	node.step = std::max (float (frame.radius/32767.0*(1.0+1e-6)),1e-30f);
+
+	for(int k=0;k<4;k++) {
+		node.cx[k] = node.cy[k] = node.cz[k] = 0;
+		node.r[k] = 0;
+		node.child[k] = BVH4Node::EMPTY;
+		if (k >= n) continue;
+
+		const Sphere& s = tree.ball (c[k]);
+		short* q[3] = {&node.cx[k],&node.cy[k],&node.cz[k]};
+		Vector3d decoded;
+		for(int j=0;j<3;j++) {
+			double v = floor ((s.center[j]-node.center[j])/node.step+0.5);
+			v = std::max (-32767.0,std::min (32767.0,v));
+			*q[j] = short (v);
+			decoded[j] = node.center[j] + v*node.step;
+		}
+		/// aufrunden, plus ein Schritt Reserve fuer die float-Rechnung der Anfrage
+		double need = (decoded-s.center).length ()+s.radius;
+		node.r[k] = (unsigned short) std::min (65535.0,ceil (need/node.step)+1.0);
+	}
+
+	int id = int (out.size ());
+	out.push_back (node);
+	for(int k=0;k<n;k++) {
+		int child = tree.node (c[k]).leaf () ? addLeaf (tree.node (c[k])) : convert (tree,c[k],out);
+		out[id].child[k] = child;
+	}
+	return id;
+}
+
+void CompactBVT::scanLeaf (int k, const Vector3d& q, double r, std::vector<int>& result) const
+{
+	int first = leaves_[2*k];
+	int end = first+leaves_[2*k+1];
+	for(int i=first;i<end;i++)
+		if ((points_[i]-q).lengthSquared () <= r*r)
+			result.push_back (index_[i]);
+}
+
+int CompactBVT::within (const Vector3d& q, double r, std::vector<int>& result) const
+{
+	result.clear ();
+	if (leaves_.empty ()) return 0;
+	double reach = r+ball_.radius;
+	if ((q-ball_.center).lengthSquared () > reach*reach) return 0;
+
+	/// der ganze Baum ist ein Blatt
+	if (nr_of_nodes_ == 0) {
+		scanLeaf (0,q,r,result);
+		return 0;
+	}
+
+	int visited = 0;
+	std::vector<int> stack;
+	stack.reserve (64);
+	stack.push_back (0);
+	while (!stack.empty ()) {
+		const BVH4Node& node = nodes_[stack.back ()];
+		stack.pop_back ();
+		visited++;
+
+		int mask = overlap4 (node,float (q[0]-node.center[0]),float (q[1]-node.center[1]),float (q[2]-node.center[2]),float (r));
+		for(int k=0;k<4;k++) {
+			int child = node.child[k];
+			if (!(mask >> k & 1) || child == BVH4Node::EMPTY) continue;
+			if (child >= 0)
+				stack.push_back (child);
+			else
+				scanLeaf (~child,q,r,result);
+		}
+	}
+	return visited;
+}
@@ -0,0 +1,76 @@
+#ifndef COMPACTBVT_H
+#define COMPACTBVT_H
+
+#include <vector>
+#include "vecmath.h"
+#include "Sphere.h"
+#include "BVT.h"
+
+/// Ein Knoten mit bis zu vier Kindern, genau eine Cache-Zeile (64 Byte).
+/** Die Kinderkugeln sind relativ zur Kugel des Knotens quantisiert:
+		Mittelpunkt = center + (cx,cy,cz)*step, Radius = r*step. Beim Kodieren
+		wird aufgerundet, die dekodierte Kugel enthaelt also immer die echte.
+		child >= 0: innerer Knoten, child < 0: Blatt ~child, EMPTY: kein Kind.
+*/
+struct BVH4Node
+{
+		float center[3];
+		float step;
+		short cx[4], cy[4], cz[4];
+		unsigned short r[4];
+		int child[4];
+
+		enum {EMPTY = -2147483647-1};
+};
+
+/// Kompakte Anfrage-Darstellung eines fertigen BVT: vierfach verzweigt,
+/// quantisierte Kugeln, Blaetter als (first,count) in den Punktpuffer
+class CompactBVT
+{
+	public:
+
+		/// aus einem gebauten Baum erzeugen
+		CompactBVT (const BVT& tree);
+
+		/// alle Punkte (Eingabe-Indizes) mit Abstand <= r zu q,
+		/// liefert die Anzahl der besuchten Knoten
+		int within (const Vector3d& q, double r, std::vector<int>& result) const;
+
+		/// Kugel um alles
+		const Sphere& ball () const {return ball_;};
+
+		int nr_of_nodes () const {return nr_of_nodes_;};
+		int nr_of_leaves () const {return int (leaves_.size ())/2;};
+
+		/// Speicher der Knoten und Blaetter in Byte (ohne Punkte)
+		size_t memory () const {return nr_of_nodes_*sizeof (BVH4Node) + leaves_.size ()*sizeof (int);};
+
+	private:
+
+		/// nicht kopierbar, nodes_ zeigt in storage_
+		CompactBVT (const CompactBVT&);
+		CompactBVT& operator= (const CompactBVT&);
+
+		/// fasst den Teilbaum unter dem inneren Knoten i in out zusammen, liefert den Knotenindex
+		int convert (const BVT& tree, int i, std::vector<BVH4Node>& out);
+
+		/// Blatt (first,count) anlegen, liefert ~index
+		int addLeaf (const BVTNode& n);
+
+		/// Punkte von Blatt k mit Abstand <= r zu q anhaengen
+		void scanLeaf (int k, const Vector3d& q, double r, std::vector<int>& result) const;
+
+		/// leaf k: points_[leaves_[2k] .. leaves_[2k]+leaves_[2k+1]-1]
+		std::vector<int> leaves_;
+
+		/// Knoten auf 64 Byte ausgerichtet in storage_
+		std::vector<char> storage_;
+		BVH4Node * nodes_;
+		int nr_of_nodes_;
+
+		std::vector<Vector3d> points_;
+		std::vector<int> index_;
+		Sphere ball_;
+};
+
+#endif //COMPACTBVT_H
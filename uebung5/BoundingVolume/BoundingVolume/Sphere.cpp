@@ -3,6 +3,8 @@
 
 #include <QtOpenGL>
 
+const double Sphere::DEGENERATE_EPS = 1e-12;
+
 Sphere::Sphere() {
   center = Vector3d(0.0,0.0,0.0);
   radius = 0.0;
@@ -22,45 +24,80 @@ Sphere::Sphere(Vector3d& a, Vector3d& b) {
   radius = 0.5*ba.length();
 }
 
-// Konstruiere die Umkugel fuer drei Punkte
-Sphere::Sphere(Vector3d& a, Vector3d& b, Vector3d& c) {
+// Umkreismittelpunkt des Dreiecks abc in geschlossener Form:
+// m = a + ((c-a)|b-a|^2 - (b-a)|c-a|^2) x n / (2|n|^2) mit n = (b-a) x (c-a).
+// |n|^2 direkt aus dem Kreuzprodukt ist auch fast kollinear genau, anders
+// als die Gram-Determinante |b-a|^2|c-a|^2 - ((b-a)*(c-a))^2.
+// Liefert false, falls a,b,c (numerisch) kollinear sind.
+bool Sphere::circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, Vector3d& m) {
   Vector3d ba = b-a;
   Vector3d ca = c-a;
-  Vector3d baxca = ba%ca;
-  Vector3d r;
-  Matrix4d T(ba[0],   ba[1],   ba[2],   0.0,
-             ca[0],   ca[1],   ca[2],   0.0,
-             baxca[0],baxca[1],baxca[2],0.0,
-             0.0,     0.0,     0.0,     1.0);
-  Matrix4d T1 = Matrix4d::inverse(T);
-  
-  r[0] = 0.5*ba.lengthSquared();
-  r[1] = 0.5*ca.lengthSquared();
-  r[2] = 0.0;
-  
-  center = T1*r;
-  radius = center.length();
-  center += a;
+  double uu = ba*ba, vv = ca*ca;
+
+  Vector3d n = ba%ca;
+  double D = n*n;
+  if (D <= DEGENERATE_EPS*uu*vv)
+    return false;
+
+  m = a + ((ca*uu - ba*vv)%n)/(2.0*D);
+  return true;
 }
 
-// Konstruiere die Umkugel fuer vier Punkte
-Sphere::Sphere(Vector3d& a, Vector3d& b, Vector3d& c, Vector3d& d) {
+// Umkugelmittelpunkt des Tetraeders abcd in geschlossener Form (Cramersche Regel).
+// Liefert false, falls a,b,c,d (numerisch) koplanar sind.
+bool Sphere::circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, Vector3d& m) {
   Vector3d ba = b-a;
   Vector3d ca = c-a;
   Vector3d da = d-a;
-  Vector3d r;
-  Matrix4d T(ba[0],ba[1],ba[2],0.0,
-             ca[0],ca[1],ca[2],0.0,
-             da[0],da[1],da[2],0.0,
-             0.0,  0.0,  0.0,  1.0);
-  Matrix4d T1 = Matrix4d::inverse(T);
-  
-  r[0] = 0.5*ba.lengthSquared();
-  r[1] = 0.5*ca.lengthSquared();
-  r[2] = 0.5*da.lengthSquared();
-  center = T1*r;
-  radius = center.length();
-  center += a;
+  double uu = ba*ba, vv = ca*ca, ww = da*da;
+
+  Vector3d caxda = ca%da;
+  double D = ba*caxda;
+  if (D*D <= DEGENERATE_EPS*uu*vv*ww)
+    return false;
+
+  m = a + (caxda*uu + (da%ba)*vv + (ba%ca)*ww)/(2.0*D);
+  return true;
+}
+
+// Konstruiere die Umkugel fuer drei Punkte
+Sphere::Sphere(Vector3d& a, Vector3d& b, Vector3d& c) {
+  if (circumcenter(a,b,c,center)) {
+    radius = (center-a).length();
+    return;
+  }
+
+  // Entartet (kollinear): die beiden entferntesten Punkte bilden den Durchmesser
+  double ab = (b-a).lengthSquared();
+  double bc = (c-b).lengthSquared();
+  double ca = (a-c).lengthSquared();
+  if (ab >= bc && ab >= ca) *this = Sphere(a,b);
+  else if (bc >= ca)        *this = Sphere(b,c);
+  else                      *this = Sphere(c,a);
+}
+
+// Konstruiere die Umkugel fuer vier Punkte
+Sphere::Sphere(Vector3d& a, Vector3d& b, Vector3d& c, Vector3d& d) {
+  if (circumcenter(a,b,c,d,center)) {
+    radius = (center-a).length();
+    return;
+  }
+
+  // Entartet (koplanar): kleinste Dreiecks-Umkugel, die alle vier Punkte enthaelt
+  Sphere S[4] = { Sphere(a,b,c), Sphere(a,b,d), Sphere(a,c,d), Sphere(b,c,d) };
+  Vector3d* q[4] = { &a, &b, &c, &d };
+  int best = -1, largest = 0;
+  for(int i=0;i<4;i++) {
+    if (S[i].radius > S[largest].radius)
+      largest = i;
+
+    bool contains = true;
+    for(int j=0;j<4 && contains;j++)
+      contains = (*q[j]-S[i].center).length() <= S[i].radius*(1.0+1e-9);
+    if (contains && (best < 0 || S[i].radius < S[best].radius))
+      best = i;
+  }
+  *this = S[best < 0 ? largest : best];
 }
 
 // Berechne den Schwerpunkt der Punktmenge p
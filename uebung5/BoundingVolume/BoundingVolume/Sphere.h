@@ -16,6 +16,10 @@
 class Sphere {
   public:
 
+  // relative Schranke (sin^2 des Winkels bzw. normiertes Volumen^2),
+  // unterhalb der drei/vier Punkte als entartet gelten
+  static const double DEGENERATE_EPS;
+
   Vector3d center;
   double radius;
 
@@ -39,6 +43,12 @@ class Sphere {
   // Berechne den Schwerpunkt der Punktmenge
   Sphere com(const std::vector<Vector3d>& p);
 
+  // Umkreismittelpunkt m von a,b,c; false falls die Punkte kollinear sind
+  static bool circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, Vector3d& m);
+
+  // Umkugelmittelpunkt m von a,b,c,d; false falls die Punkte koplanar sind
+  static bool circumcenter(const Vector3d& a, const Vector3d& b, const Vector3d& c, const Vector3d& d, Vector3d& m);
+
 	/// Malt die Kugel
 	void draw(Vector3d color = Vector3d(0.7,0.6,0.7)) const;
 
@@ -0,0 +1,182 @@
+#include "SphereBatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/// relative Toleranz des Enthaltenseins-Tests
+const double CONTAIN_EPS = 1e-12;
+
+inline bool outside (const Vector3d& p, const Sphere& S)
+{
+	return (p-S.center).lengthSquared () > S.radius*S.radius*(1.0+CONTAIN_EPS) + CONTAIN_EPS;
+}
+
+/// p[i] an den Anfang, p[0..i-1] ruecken nach: Punkte, die die Kugel
+/// vergroessert haben, werden zuerst wieder getestet (Gaertner 1999)
+inline void moveToFront (Vector3d * p, int i)
+{
+	Vector3d x = p[i];
+	for(int j=i;j>0;j--)
+		p[j] = p[j-1];
+	p[0] = x;
+}
+
+/// kleiner xorshift-Generator, rand() ist nicht thread-sicher
+inline unsigned int nextRandom (unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// Welzl mit den Randpunkten q1,q2,q3 (wie Sphere::ses3, aber ohne Kopien).
+// Die Randpunkte liegen hinter p[0..n-1], moveToFront veraendert sie nicht.
+Sphere ses3 (int n, Vector3d * p, Vector3d& q1, Vector3d& q2, Vector3d& q3)
+{
+	Sphere S (q1,q2,q3);
+	for(int i=0;i<n;i++)
+		if (outside (p[i],S)) {
+			S = Sphere (q1,q2,q3,p[i]);
+			moveToFront (p,i);
+		}
+	return S;
+}
+
+Sphere ses2 (int n, Vector3d * p, Vector3d& q1, Vector3d& q2)
+{
+	Sphere S (q1,q2);
+	for(int i=0;i<n;i++)
+		if (outside (p[i],S)) {
+			S = ses3 (i,p,q1,q2,p[i]);
+			moveToFront (p,i);
+		}
+	return S;
+}
+
+Sphere ses1 (int n, Vector3d * p, Vector3d& q1)
+{
+	Sphere S (q1);
+	for(int i=0;i<n;i++)
+		if (outside (p[i],S)) {
+			S = ses2 (i,p,q1,p[i]);
+			moveToFront (p,i);
+		}
+	return S;
+}
+
+}
+
+Sphere SphereBatch::exact (Vector3d * p, int n, unsigned int seed)
+{
+	if (n <= 0) return Sphere ();
+
+	// zufaellige Permutation, seed != 0 fuer xorshift
+	unsigned int state = seed*2654435761u + 1u;
+	for(int i=n-1;i>0;i--) {
+		int j = int (nextRandom (state) % (unsigned int)(i+1));
+		Vector3d d = p[i];
+		p[i] = p[j];
+		p[j] = d;
+	}
+
+	Sphere S (p[0]);
+	for(int i=1;i<n;i++)
+		if (outside (p[i],S)) {
+			S = ses1 (i,p,p[i]);
+			moveToFront (p,i);
+		}
+	return S;
+}
+
+Sphere SphereBatch::approx (const Vector3d * p, int n)
+{
+	Sphere S;
+	if (n <= 0) return S;
+
+	// Ritter: entferntester Punkt y von p[0], dann entferntester z von y
+	int y = 0, z = 0;
+	double dmax = -1.0;
+	for(int i=0;i<n;i++) {
+		double d = (p[i]-p[0]).lengthSquared ();
+		if (d > dmax) { dmax = d; y = i; }
+	}
+	dmax = -1.0;
+	for(int i=0;i<n;i++) {
+		double d = (p[i]-p[y]).lengthSquared ();
+		if (d > dmax) { dmax = d; z = i; }
+	}
+
+	S.center = (p[y]+p[z])*0.5;
+	S.radius = 0.5*sqrt (dmax);
+
+	// Kugel schrittweise um die restlichen Punkte erweitern
+	for(int i=0;i<n;i++) {
+		Vector3d d = p[i]-S.center;
+		double l2 = d.lengthSquared ();
+		if (l2 > S.radius*S.radius) {
+			double l = sqrt (l2);
+			double r = 0.5*(S.radius+l);
+			S.center += d*((r-S.radius)/l);
+			S.radius = r;
+		}
+	}
+	return S;
+}
+
+void SphereBatch::compute (const std::vector<Vector3d>& points,
+													 const std::vector<int>& offsets,
+													 Mode mode)
+{
+	int n = offsets.empty () ? 0 : int (offsets.size ())-1;
+	cx.resize (n);
+	cy.resize (n);
+	cz.resize (n);
+	radius.resize (n);
+
+#pragma omp parallel
+	{
+		/// Arbeitsspeicher pro Thread, waechst nur mit dem groessten Cluster
+		std::vector<Vector3d> work;
+
+#pragma omp for schedule(dynamic,64)
+		for(int i=0;i<n;i++) {
+			int begin = offsets[i];
+			int count = offsets[i+1]-begin;
+
+			Sphere S;
+			if (mode == APPROX)
+				S = approx (count > 0 ? &points[begin] : NULL, count);
+			else if (count > 0) {
+				if (int (work.size ()) < count) work.resize (count);
+				std::copy (points.begin ()+begin, points.begin ()+begin+count, work.begin ());
+				/// doppelte Punkte entfernen wie in Sphere (std::vector); danach
+				/// den Radius um die dabei weggefallenen Nachbarn (< 1e-5) erweitern
+				std::sort (work.begin (), work.begin ()+count);
+				int unique = int (std::unique (work.begin (), work.begin ()+count, epsilonEquals)-work.begin ());
+				S = exact (&work[0], unique, (unsigned int)i);
+				if (unique < count) {
+					double r2 = S.radius*S.radius;
+					for(int k=begin;k<begin+count;k++)
+						r2 = std::max (r2,(points[k]-S.center).lengthSquared ());
+					S.radius = sqrt (r2);
+				}
+			}
+
+			cx[i] = S.center[0];
+			cy[i] = S.center[1];
+			cz[i] = S.center[2];
+			radius[i] = S.radius;
+		}
+	}
+}
+
+Sphere SphereBatch::sphere (int i) const
+{
+	Sphere S;
+	S.center = Vector3d (cx[i],cy[i],cz[i]);
+	S.radius = radius[i];
+	return S;
+}
@@ -0,0 +1,49 @@
+#ifndef SPHEREBATCH_H
+#define SPHEREBATCH_H
+
+#include <vector>
+#include "vecmath.h"
+#include "Sphere.h"
+
+/// Berechnet die Huellkugeln vieler kleiner Punktmengen auf einmal.
+/** Die Punktmengen liegen hintereinander in einem flachen Array,
+		Cluster i besteht aus points[offsets[i]] .. points[offsets[i+1]-1].
+		Die Cluster werden parallel (OpenMP) abgearbeitet, jeder Thread
+		benutzt dabei einen eigenen, wiederverwendeten Arbeitsspeicher.
+*/
+class SphereBatch
+{
+	public:
+
+		enum Mode {
+			/// kleinste einschliessende Kugel (Welzl mit move-to-front),
+			/// doppelte Punkte (< 1e-5) werden vorher entfernt wie in Sphere (std::vector)
+			EXACT,
+			/// Ritter-Kugel, O(n), typisch 5-20% groesser als EXACT
+			APPROX
+		};
+
+		/// Ergebnis als SoA; BVT::refit () berechnet damit alle Blattkugeln
+		/// in einem Durchlauf und liest sie ueber sphere () aus
+		std::vector<double> cx, cy, cz, radius;
+
+		/// berechne die Kugeln aller Cluster
+		void compute (const std::vector<Vector3d>& points,
+									const std::vector<int>& offsets,
+									Mode mode = EXACT);
+
+		/// anzahl der Kugeln
+		int size () const {return int(radius.size ());};
+
+		/// Kugel i als Sphere
+		Sphere sphere (int i) const;
+
+		/// kleinste einschliessende Kugel von p[0..n-1], p wird umsortiert;
+		/// p sollte keine doppelten Punkte enthalten
+		static Sphere exact (Vector3d * p, int n, unsigned int seed);
+
+		/// Ritter-Kugel von p[0..n-1]
+		static Sphere approx (const Vector3d * p, int n);
+};
+
+#endif //SPHEREBATCH_H
@@ -0,0 +1,158 @@
+#ifndef CONVEXSHAPES_H
+#define CONVEXSHAPES_H
+
+#include <vector>
+#include "vecmath.h"
+#include "SupportMap.h"
+#include "Pose.h"
+
+// Support-mapping shapes for GJK. Every shape provides
+//   Vector3d support(const Vector3d& d) const  - a point p of the shape with maximal p*d
+//   Vector3d center() const                     - some point inside the shape
+// Shapes are small value types that only refer to their vertex data; GJK
+// takes them by value, so every query works on its own copies.
+
+// a single point
+struct PointShape {
+    Vector3d p;
+
+    PointShape(const Vector3d& p) : p(p) {}
+
+    Vector3d support(const Vector3d&) const { return p; }
+    Vector3d center() const { return p; }
+};
+
+// convex hull of a point cloud, linear scan over all points
+struct PointCloudShape {
+    const std::vector<Vector3d>* P;
+
+    PointCloudShape(const std::vector<Vector3d>& points) : P(&points) {}
+
+    Vector3d support(const Vector3d& d) const {
+        const std::vector<Vector3d>& p=*P;
+        int best=0;
+        double bestDot=p[0]*d;
+        for(unsigned int i=1; i<p.size(); i++){
+            double dot=p[i]*d;
+            if(dot>bestDot){
+                bestDot=dot;
+                best=i;
+            }
+        }
+        return p[best];
+    }
+    Vector3d center() const { return (*P)[0]; }
+};
+
+// convex hull of a point cloud via SupportMap; climbs from the vertex of
+// the previous support query of this shape object
+struct HullShape {
+    const SupportMap* map;
+    mutable int hint;
+
+    HullShape(const SupportMap& m, int hint=-1) : map(&m), hint(hint) {}
+
+    Vector3d support(const Vector3d& d) const {
+        hint=map->support(d,hint);
+        return map->point(hint);
+    }
+    Vector3d center() const { return map->point(0); }
+};
+
+struct SphereShape {
+    Vector3d c;
+    double r;
+
+    SphereShape(const Vector3d& c, double r) : c(c), r(r) {}
+
+    Vector3d support(const Vector3d& d) const {
+        double l=d.length();
+        return l>0 ? c+d*(r/l) : c;
+    }
+    Vector3d center() const { return c; }
+};
+
+// oriented box: center, three orthonormal axes and half extents
+struct BoxShape {
+    Vector3d c;
+    Vector3d axis[3];
+    Vector3d half;
+
+    // axis-aligned
+    BoxShape(const Vector3d& c, const Vector3d& half) : c(c), half(half) {
+        axis[0]=Vector3d(1.0,0.0,0.0);
+        axis[1]=Vector3d(0.0,1.0,0.0);
+        axis[2]=Vector3d(0.0,0.0,1.0);
+    }
+    BoxShape(const Vector3d& c, const Vector3d& a0, const Vector3d& a1, const Vector3d& a2, const Vector3d& half)
+        : c(c), half(half) {
+        axis[0]=a0; axis[1]=a1; axis[2]=a2;
+    }
+
+    Vector3d support(const Vector3d& d) const {
+        Vector3d p=c;
+        for(int k=0; k<3; k++){
+            p+=axis[k]*(axis[k]*d<0 ? -half[k] : half[k]);
+        }
+        return p;
+    }
+    Vector3d center() const { return c; }
+};
+
+// segment a-b swept by a sphere of radius r
+struct CapsuleShape {
+    Vector3d a, b;
+    double r;
+
+    CapsuleShape(const Vector3d& a, const Vector3d& b, double r) : a(a), b(b), r(r) {}
+
+    Vector3d support(const Vector3d& d) const {
+        const Vector3d& p=(b-a)*d>0 ? b : a;
+        double l=d.length();
+        return l>0 ? p+d*(r/l) : p;
+    }
+    Vector3d center() const { return (a+b)*0.5; }
+};
+
+// a shape moved by the rigid transform M (rotation and translation only):
+// the direction is rotated into the local frame, the support point back
+template<class S>
+struct TransformedShape {
+    S shape;
+    Matrix4d M;
+
+    TransformedShape(const S& shape, const Matrix4d& M) : shape(shape), M(M) {}
+
+    Vector3d support(const Vector3d& d) const {
+        return M*shape.support(Matrix4d::transform3x3(d,M));
+    }
+    Vector3d center() const { return M*shape.center(); }
+};
+
+template<class S>
+inline TransformedShape<S> transformed(const S& shape, const Matrix4d& M) {
+    return TransformedShape<S>(shape,M);
+}
+
+// a shape in its local frame placed by a Pose: the same as
+// TransformedShape, but moving it touches neither the vertex data nor a
+// matrix, and the pose stays a rigid transform under repeated turns
+template<class S>
+struct PosedShape {
+    S shape;
+    Pose pose;
+
+    PosedShape(const S& shape, const Pose& pose) : shape(shape), pose(pose) {}
+
+    Vector3d support(const Vector3d& d) const {
+        return pose.apply(shape.support(pose.toLocal(d)));
+    }
+    Vector3d center() const { return pose.apply(shape.center()); }
+};
+
+template<class S>
+inline PosedShape<S> posed(const S& shape, const Pose& pose) {
+    return PosedShape<S>(shape,pose);
+}
+
+#endif // CONVEXSHAPES_H
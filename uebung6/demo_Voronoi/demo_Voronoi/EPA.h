@@ -0,0 +1,454 @@
+#ifndef EPA_H
+#define EPA_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "vecmath.h"
+#include "GJK.h"
+
+// Expanding Polytope Algorithm: penetration depth and contact normal of two
+// overlapping shapes, started from the tetrahedron GJK ends with. The
+// polytope in A-B is grown towards its face closest to the origin until the
+// support point in that face's normal direction lies on the face.
+
+// default relative accuracy of the depth; curved shapes converge slowly,
+// polyhedra usually terminate exactly after a few iterations
+const double EPA_EPS=1e-6;
+
+struct EPAFace {
+    int v[3];
+    Vector3d n;
+    double d;
+};
+
+// Face, vertex and horizon edge buffers. clear() keeps the capacity, so a
+// workspace reused across queries stops allocating after the first ones.
+// One workspace per thread.
+struct EPAWorkspace {
+    std::vector<GJKVertex> vertices;
+    std::vector<EPAFace> faces;
+    std::vector<int> edges;
+
+    EPAWorkspace() {
+        vertices.reserve(136);
+        faces.reserve(272);
+        edges.reserve(64);
+    }
+
+    void clear() {
+        vertices.clear();
+        faces.clear();
+        edges.clear();
+    }
+};
+
+struct EPAResult {
+    enum Status {
+        CONVERGED,      // support point on the closest face within eps
+        TOUCHING,       // no tetrahedron, the shapes touch without volume
+        STALLED,        // rounding broke the polytope, depth is the best found
+        MAX_ITERATIONS  // iteration cap hit, depth only an upper bound
+    };
+    Status status;
+    // penetration depth, moving B by depth*normal makes the shapes touch
+    double depth;
+    // unit contact normal pointing from A towards B
+    Vector3d normal;
+    // deepest points of A and B, pointA-pointB = depth*normal
+    Vector3d pointA, pointB;
+    int iterations;
+
+    bool converged() const { return status==CONVERGED; }
+};
+
+inline void epaAddFace(EPAWorkspace& ws, int a, int b, int c) {
+    EPAFace f;
+    f.v[0]=a; f.v[1]=b; f.v[2]=c;
+    const Vector3d& wa=ws.vertices[a].w;
+    f.n=(ws.vertices[b].w-wa)%(ws.vertices[c].w-wa);
+    double l=f.n.length();
+    if(l>0){
+        f.n/=l;
+        f.d=f.n*wa;
+    }else{
+        //degenerate sliver: keeps the polytope closed, is never expanded
+        f.d=1e300;
+    }
+    ws.faces.push_back(f);
+}
+
+// horizon edge a->b; the reverse edge of a neighbouring visible face cancels it
+inline void epaAddEdge(EPAWorkspace& ws, int a, int b) {
+    for(unsigned int i=0; i<ws.edges.size(); i+=2){
+        if(ws.edges[i]==b && ws.edges[i+1]==a){
+            ws.edges[i]=ws.edges[ws.edges.size()-2];
+            ws.edges[i+1]=ws.edges[ws.edges.size()-1];
+            ws.edges.resize(ws.edges.size()-2);
+            return;
+        }
+    }
+    ws.edges.push_back(a);
+    ws.edges.push_back(b);
+}
+
+// Makes a tetrahedron out of a GJK simplex that ended with fewer vertices
+// (the shapes only touch, or the origin lies on a face or edge of the
+// simplex) by adding support points in directions off its span.
+template<class A, class B>
+bool epaSeed(const A& a, const B& b, GJKSimplex& s) {
+    double scale=0;
+    for(int i=0; i<s.n; i++) scale=std::max(scale,s.v[i].w.lengthSquared());
+    double tiny=1e-20*std::max(scale,1e-300);
+
+    if(s.n==1){
+        Vector3d axis[6]={Vector3d(1.0,0.0,0.0),Vector3d(-1.0,0.0,0.0),Vector3d(0.0,1.0,0.0),
+                          Vector3d(0.0,-1.0,0.0),Vector3d(0.0,0.0,1.0),Vector3d(0.0,0.0,-1.0)};
+        for(int k=0; k<6 && s.n==1; k++){
+            GJKVertex x=gjkSupport(a,b,axis[k]);
+            if((x.w-s.v[0].w).lengthSquared()>tiny) s.add(x);
+        }
+    }
+    if(s.n==2){
+        Vector3d d=s.v[1].w-s.v[0].w;
+        d.normalize();
+        int k=fabs(d[0])<fabs(d[1]) ? (fabs(d[0])<fabs(d[2]) ? 0 : 2) : (fabs(d[1])<fabs(d[2]) ? 1 : 2);
+        Vector3d e;
+        e[k]=1.0;
+        Vector3d p=d%e;
+        Quat4d rot(M_PI/3,d);
+        for(int i=0; i<6 && s.n==2; i++){
+            GJKVertex x=gjkSupport(a,b,p);
+            Vector3d r=x.w-s.v[0].w;
+            if((r-d*(r*d)).lengthSquared()>tiny) s.add(x);
+            p=rot*p;
+        }
+    }
+    if(s.n==3){
+        Vector3d n=(s.v[1].w-s.v[0].w)%(s.v[2].w-s.v[0].w);
+        n.normalize();
+        GJKVertex x=gjkSupport(a,b,n);
+        if(fabs((x.w-s.v[0].w)*n)*fabs((x.w-s.v[0].w)*n)<=tiny) x=gjkSupport(a,b,-n);
+        if(fabs((x.w-s.v[0].w)*n)*fabs((x.w-s.v[0].w)*n)>tiny) s.add(x);
+    }
+    return s.n==4;
+}
+
+// Penetration of two overlapping shapes from the final simplex of
+// gjkDistance (status INTERSECT). Returns false if the simplex cannot be
+// grown to a tetrahedron, i.e. the shapes touch without volume; r then
+// holds depth 0 and the GJK witness. A result from the last face examined
+// is returned with true as well, r.status tells whether it converged.
+template<class A, class B>
+bool epa(A a, B b, const GJKSimplex& simplex, EPAResult& r, EPAWorkspace& ws,
+         double eps=EPA_EPS, int maxIterations=128) {
+    ws.clear();
+    r.iterations=0;
+    r.depth=0;
+    r.status=EPAResult::TOUCHING;
+
+    GJKSimplex s=simplex;
+    if(!epaSeed(a,b,s)){
+        r.pointA=r.pointB=Vector3d();
+        for(int i=0; i<s.n; i++){
+            r.pointA+=s.v[i].a*(1.0/s.n);
+            r.pointB+=s.v[i].b*(1.0/s.n);
+        }
+        r.normal=(b.center()-a.center());
+        if(r.normal.lengthSquared()>0) r.normal.normalize();
+        return false;
+    }
+
+    double scale=0;
+    for(int i=0; i<4; i++){
+        ws.vertices.push_back(s.v[i]);
+        scale=std::max(scale,s.v[i].w.length());
+    }
+    //faces of the tetrahedron, wound so that the normals point outwards
+    static const int face[4][4]={{0,1,2,3},{0,3,1,2},{0,2,3,1},{1,3,2,0}};
+    for(int k=0; k<4; k++){
+        const Vector3d& w0=s.v[face[k][0]].w;
+        Vector3d n=(s.v[face[k][1]].w-w0)%(s.v[face[k][2]].w-w0);
+        if((s.v[face[k][3]].w-w0)*n>0) epaAddFace(ws,face[k][0],face[k][2],face[k][1]);
+        else epaAddFace(ws,face[k][0],face[k][1],face[k][2]);
+    }
+
+    //coplanar support points are common (boxes, hull faces): only faces
+    //clearly in front of a new vertex count as visible, so that rounding
+    //cannot punch holes into the visible region
+    EPAFace fb=ws.faces[0];
+    fb.d=-1e300;
+    while(true){
+        int best=0;
+        for(unsigned int f=1; f<ws.faces.size(); f++){
+            if(ws.faces[f].d<ws.faces[best].d) best=f;
+        }
+        //the closest face never gets closer in exact arithmetic; if it
+        //does, the polytope is broken and the previous face is the answer
+        if(ws.faces[best].d<fb.d-1e-9*scale){
+            r.status=EPAResult::STALLED;
+            break;
+        }
+        fb=ws.faces[best];
+        if(r.iterations>=maxIterations){
+            r.status=EPAResult::MAX_ITERATIONS;
+            break;
+        }
+        r.iterations++;
+
+        GJKVertex x=gjkSupport(a,b,fb.n);
+        scale=std::max(scale,x.w.length());
+        if(x.w*fb.n-fb.d<=eps*scale){
+            r.status=EPAResult::CONVERGED;
+            break;
+        }
+
+        int k=int(ws.vertices.size());
+        ws.vertices.push_back(x);
+
+        //remove every face that sees the new vertex, remember the horizon
+        ws.edges.clear();
+        for(unsigned int f=0; f<ws.faces.size();){
+            const EPAFace& g=ws.faces[f];
+            if(g.d<1e300 && g.n*(x.w-ws.vertices[g.v[0]].w)>1e-12*scale){
+                epaAddEdge(ws,g.v[0],g.v[1]);
+                epaAddEdge(ws,g.v[1],g.v[2]);
+                epaAddEdge(ws,g.v[2],g.v[0]);
+                ws.faces[f]=ws.faces.back();
+                ws.faces.pop_back();
+            }else f++;
+        }
+        for(unsigned int e=0; e<ws.edges.size(); e+=2){
+            epaAddFace(ws,ws.edges[e],ws.edges[e+1],k);
+        }
+        if(ws.faces.empty()){
+            r.status=EPAResult::STALLED;
+            return false;
+        }
+    }
+
+    //closest point of the best face to the origin in barycentric coordinates
+    const EPAFace& f=fb;
+    const GJKVertex& v0=ws.vertices[f.v[0]];
+    const GJKVertex& v1=ws.vertices[f.v[1]];
+    const GJKVertex& v2=ws.vertices[f.v[2]];
+    Vector3d p=f.n*f.d;
+    Vector3d e0=v1.w-v0.w, e1=v2.w-v0.w, e2=p-v0.w;
+    double d00=e0*e0, d01=e0*e1, d11=e1*e1, d20=e2*e0, d21=e2*e1;
+    double den=d00*d11-d01*d01;
+    double l1=den!=0 ? (d11*d20-d01*d21)/den : 1.0/3;
+    double l2=den!=0 ? (d00*d21-d01*d20)/den : 1.0/3;
+    double l0=1.0-l1-l2;
+
+    r.depth=std::max(f.d,0.0);
+    r.normal=f.n;
+    r.pointA=v0.a*l0+v1.a*l1+v2.a*l2;
+    r.pointB=v0.b*l0+v1.b*l1+v2.b*l2;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Contact manifold: up to four contact points for a penetrating pair.
+// The shapes only offer support points, so the touching features are
+// sampled with support queries in directions tilted slightly around the
+// normal: a face yields its corner points, an edge its end points, a curved
+// surface a small cluster that is merged into one point. B's feature is
+// clipped against the side planes of A's feature polygon (or vice versa).
+
+struct ContactPoint {
+    // halfway between the two surfaces
+    Vector3d point;
+    double depth;
+};
+
+struct ContactManifold {
+    // from A towards B
+    Vector3d normal;
+    int n;
+    ContactPoint points[4];
+};
+
+// direction count for feature sampling
+const int CONTACT_SAMPLES=8;
+
+// support points of s in direction d tilted by CONTACT_SAMPLES directions
+// of the tangent plane (u,v), keeps those within tol of the deepest one
+template<class S>
+int contactFeature(const S& s, const Vector3d& d, const Vector3d& u, const Vector3d& v,
+                   double tol, double merge, Vector3d* out) {
+    Vector3d p[CONTACT_SAMPLES+1];
+    p[0]=s.support(d);
+    for(int i=0; i<CONTACT_SAMPLES; i++){
+        double phi=2*M_PI*i/CONTACT_SAMPLES;
+        p[i+1]=s.support(d+(u*cos(phi)+v*sin(phi))*0.01);
+    }
+    double top=p[0]*d;
+    for(int i=1; i<=CONTACT_SAMPLES; i++) top=std::max(top,p[i]*d);
+
+    //keep distinct points of the feature, in (u,v)-angle order as sampled
+    int n=0;
+    for(int i=0; i<=CONTACT_SAMPLES; i++){
+        if(p[i]*d<top-tol) continue;
+        bool known=false;
+        for(int j=0; j<n && !known; j++) known=(out[j]-p[i]).lengthSquared()<=merge*merge;
+        if(!known) out[n++]=p[i];
+    }
+    return n;
+}
+
+// 2D convex hull (monotone chain) of pts in the (u,v) plane, counter-clockwise
+inline int contactPolygon(Vector3d* pts, int n, const Vector3d& u, const Vector3d& v) {
+    if(n<3) return n;
+    //insertion sort by (u,v)
+    for(int i=1; i<n; i++){
+        Vector3d x=pts[i];
+        int j=i-1;
+        while(j>=0 && (pts[j]*u>x*u || (pts[j]*u==x*u && pts[j]*v>x*v))){
+            pts[j+1]=pts[j];
+            j--;
+        }
+        pts[j+1]=x;
+    }
+    Vector3d h[2*(CONTACT_SAMPLES+1)];
+    int k=0;
+    for(int pass=0; pass<2; pass++){
+        int start=k;
+        for(int i=0; i<n; i++){
+            const Vector3d& x=pts[pass==0 ? i : n-1-i];
+            while(k>=start+2){
+                Vector3d a=h[k-1]-h[k-2], b=x-h[k-2];
+                if((a*u)*(b*v)-(a*v)*(b*u)>0) break;
+                k--;
+            }
+            h[k++]=x;
+        }
+        k--;
+    }
+    for(int i=0; i<k; i++) pts[i]=h[i];
+    return k;
+}
+
+// Clips the points/polygon q (nq) against the prism over polygon p (np >= 3,
+// counter-clockwise in (u,v)) along the normal. out gets at most nq+np points.
+inline int contactClip(const Vector3d* p, int np, const Vector3d* q, int nq,
+                       const Vector3d& normal, Vector3d* out) {
+    Vector3d buf[2][2*(CONTACT_SAMPLES+1)+2];
+    int n=nq;
+    for(int i=0; i<nq; i++) buf[0][i]=q[i];
+    int cur=0;
+    for(int e=0; e<np && n>0; e++){
+        const Vector3d& a=p[e];
+        Vector3d side=normal%(p[(e+1)%np]-a);
+        //inside: (x-a)*side >= 0 for a counter-clockwise polygon
+        const Vector3d* in=buf[cur];
+        Vector3d* o=buf[1-cur];
+        int m=0;
+        for(int i=0; i<n; i++){
+            const Vector3d& x=in[i];
+            const Vector3d& y=in[(i+1)%n];
+            double dx=(x-a)*side, dy=(y-a)*side;
+            if(dx>=0) o[m++]=x;
+            if(n>1 && (dx>=0)!=(dy>=0) && (n>2 || i==0)) o[m++]=x+(y-x)*(dx/(dx-dy));
+        }
+        n=m;
+        cur=1-cur;
+    }
+    for(int i=0; i<n; i++) out[i]=buf[cur][i];
+    return n;
+}
+
+// reduces c (n points) to at most four: deepest, farthest from it, then the
+// two that span the largest area with them
+inline int contactReduce(ContactPoint* c, int n, const Vector3d& normal) {
+    if(n<=4) return n;
+    ContactPoint r[4];
+    int i0=0;
+    for(int i=1; i<n; i++) if(c[i].depth>c[i0].depth) i0=i;
+    int i1=i0==0 ? 1 : 0;
+    for(int i=0; i<n; i++){
+        if((c[i].point-c[i0].point).lengthSquared()>(c[i1].point-c[i0].point).lengthSquared()) i1=i;
+    }
+    //largest triangle area on either side of the first segment
+    int i2=-1, i3=-1;
+    double best2=0, best3=0;
+    for(int i=0; i<n; i++){
+        if(i==i0 || i==i1) continue;
+        double area=((c[i0].point-c[i].point)%(c[i1].point-c[i].point))*normal;
+        if(area>best2){ best2=area; i2=i; }
+        if(-area>best3){ best3=-area; i3=i; }
+    }
+    int m=0;
+    r[m++]=c[i0];
+    r[m++]=c[i1];
+    if(i2>=0) r[m++]=c[i2];
+    if(i3>=0) r[m++]=c[i3];
+    for(int i=0; i<m; i++) c[i]=r[i];
+    return m;
+}
+
+// Contact manifold of A and B. Returns false (m.n=0) if they are separated.
+template<class A, class B>
+bool contactManifold(A a, B b, ContactManifold& m, EPAWorkspace& ws) {
+    m.n=0;
+    GJKResult g;
+    gjkDistance(a,b,g);
+    if(!g.intersect()) return false;
+    EPAResult e;
+    epa(a,b,g.simplex,e,ws);
+
+    Vector3d n=e.normal;
+    m.normal=n;
+    if(n.lengthSquared()==0) return false;
+    int k=fabs(n[0])<fabs(n[1]) ? (fabs(n[0])<fabs(n[2]) ? 0 : 2) : (fabs(n[1])<fabs(n[2]) ? 1 : 2);
+    Vector3d axis;
+    axis[k]=1.0;
+    Vector3d u=n%axis;
+    u.normalize();
+    Vector3d v=n%u;
+
+    //tolerances relative to the size of the shapes around the contact
+    double scale=(a.support(n)-a.center()).length()+(b.support(-n)-b.center()).length();
+    double tol=1e-3*scale, merge=1e-2*scale;
+
+    //A's feature facing B (direction n), B's facing A (direction -n)
+    Vector3d fa[CONTACT_SAMPLES+1], fb[CONTACT_SAMPLES+1];
+    int na=contactPolygon(fa,contactFeature(a,n,u,v,tol,merge,fa),u,v);
+    int nb=contactPolygon(fb,contactFeature(b,-n,u,v,tol,merge,fb),u,v);
+
+    //clip the smaller feature against the polygon of the other
+    Vector3d clipped[2*(CONTACT_SAMPLES+1)+2];
+    int nc=0;
+    bool onB=true;
+    if(na>=3) nc=contactClip(fa,na,fb,nb,n,clipped);
+    else if(nb>=3){ nc=contactClip(fb,nb,fa,na,n,clipped); onB=false; }
+
+    ContactPoint c[2*(CONTACT_SAMPLES+1)+2];
+    int count=0;
+    if(nc>0){
+        //depth against the plane of the other feature
+        double top=0;
+        const Vector3d* other=onB ? fa : fb;
+        int no=onB ? na : nb;
+        for(int i=0; i<no; i++) top+=other[i]*n;
+        top/=no;
+        for(int i=0; i<nc; i++){
+            double depth=onB ? top-clipped[i]*n : clipped[i]*n-top;
+            if(depth<-tol) continue;
+            c[count].depth=std::max(depth,0.0);
+            c[count].point=onB ? clipped[i]+n*(0.5*depth) : clipped[i]-n*(0.5*depth);
+            count++;
+        }
+    }
+    if(count==0){
+        //vertex or edge contacts, curved surfaces: the EPA point
+        c[0].point=(e.pointA+e.pointB)*0.5;
+        c[0].depth=e.depth;
+        count=1;
+    }
+
+    m.n=contactReduce(c,count,n);
+    for(int i=0; i<m.n; i++) m.points[i]=c[i];
+    return true;
+}
+
+#endif // EPA_H
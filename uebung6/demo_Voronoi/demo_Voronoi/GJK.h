@@ -0,0 +1,474 @@
+#ifndef GJK_H
+#define GJK_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "vecmath.h"
+#include "ConvexShapes.h"
+
+// Header-only GJK on two support-mapping shapes (see ConvexShapes.h).
+// The Minkowski difference A-B is never built: its support point in
+// direction d is A.support(d)-B.support(-d). All state lives on the stack
+// of the query, so any number of queries may run concurrently.
+
+// vertex of the simplex in A-B, together with the points of A and B it
+// came from and the search direction that produced it
+struct GJKVertex {
+    Vector3d w, a, b, d;
+};
+
+// up to four vertices and the barycentric coordinates of the point
+// closest to the origin
+struct GJKSimplex {
+    GJKVertex v[4];
+    double lambda[4];
+    int n;
+
+    GJKSimplex() : n(0) {}
+
+    void add(const GJKVertex& x) { v[n++]=x; }
+
+    Vector3d closest() const {
+        Vector3d p;
+        for(int i=0; i<n; i++) p+=v[i].w*lambda[i];
+        return p;
+    }
+};
+
+// relative tolerance of the touching test |v|^2 <= GJK_EPS*max|w|^2
+const double GJK_EPS=1e-12;
+
+// default relative accuracy of gjkDistance
+const double GJK_DISTANCE_EPS=1e-8;
+
+template<class A, class B>
+inline GJKVertex gjkSupport(const A& a, const B& b, const Vector3d& d) {
+    GJKVertex x;
+    x.a=a.support(d);
+    x.b=b.support(-d);
+    x.w=x.a-x.b;
+    x.d=d;
+    return x;
+}
+
+// Per-pair state carried from one query to the next (temporal coherence).
+// Shapes move between queries, so the simplex is kept as the search
+// directions of its vertices and re-evaluated on the moved shapes.
+struct GJKCache {
+    // last closest point of A-B to the origin, a separating axis if the
+    // pair was apart
+    Vector3d axis;
+    Vector3d dir[4];
+    int n;
+    bool valid;
+
+    GJKCache() : n(0), valid(false) {}
+
+    void reset() { n=0; valid=false; }
+
+    void store(const GJKSimplex& s, const Vector3d& v) {
+        n=s.n;
+        for(int i=0; i<n; i++) dir[i]=s.v[i].d;
+        if(v.lengthSquared()>0) axis=v;
+        valid=valid || v.lengthSquared()>0;
+    }
+};
+
+// closest feature of a simplex to the origin: n vertices idx with weights l
+struct GJKFeature {
+    int n;
+    int idx[4];
+    double l[4];
+    double dist2;
+};
+
+inline void gjkSetFeature(GJKFeature& f, int i0, double l0) {
+    f.n=1; f.idx[0]=i0; f.l[0]=l0;
+}
+
+inline void gjkSetFeature(GJKFeature& f, int i0, double l0, int i1, double l1) {
+    f.n=2; f.idx[0]=i0; f.l[0]=l0; f.idx[1]=i1; f.l[1]=l1;
+}
+
+inline void gjkSetFeature(GJKFeature& f, int i0, double l0, int i1, double l1, int i2, double l2) {
+    f.n=3; f.idx[0]=i0; f.l[0]=l0; f.idx[1]=i1; f.l[1]=l1; f.idx[2]=i2; f.l[2]=l2;
+}
+
+inline double gjkDist2(const GJKSimplex& s, const GJKFeature& f) {
+    Vector3d p;
+    for(int i=0; i<f.n; i++) p+=s.v[f.idx[i]].w*f.l[i];
+    return p.lengthSquared();
+}
+
+// Signed volumes sub-algorithm (Montanari, Petrinic, Barbieri: Improving
+// the GJK algorithm for faster and more reliable distance queries between
+// convex objects, ACM TOG 2017). The barycentric coordinates of the
+// origin's projection are ratios of signed sub-volumes; a sub-volume with
+// the wrong sign names the facet the closest point lies on, which is then
+// solved one dimension lower. Triangles are projected onto the coordinate
+// plane in which they are largest, which keeps the areas well conditioned.
+
+// both strictly of the same sign; zero counts as outside
+inline bool gjkSameSign(double a, double b) {
+    return (a>0 && b>0) || (a<0 && b<0);
+}
+
+// closest point of segment w[i0] w[i1] to the origin; the signed lengths
+// are taken along t = w[i1]-w[i0] itself
+inline void gjkS1D(const GJKSimplex& s, int i0, int i1, GJKFeature& f) {
+    const Vector3d& a=s.v[i0].w;
+    const Vector3d& b=s.v[i1].w;
+    Vector3d t=b-a;
+    double c0=b*t, c1=-(a*t);
+    if(c0>0 && c1>0){
+        double mu=1.0/(c0+c1);
+        gjkSetFeature(f,i0,c0*mu,i1,c1*mu);
+    }
+    else if(c1<=0) gjkSetFeature(f,i0,1.0);
+    else gjkSetFeature(f,i1,1.0);
+}
+
+// closest point of triangle w[i0] w[i1] w[i2] to the origin
+inline void gjkS2D(const GJKSimplex& s, int i0, int i1, int i2, GJKFeature& f) {
+    static const int next[3]={1,2,0};
+    const Vector3d& a=s.v[i0].w;
+    const Vector3d& b=s.v[i1].w;
+    const Vector3d& c=s.v[i2].w;
+    Vector3d n=(b-a)%(c-a);
+    double nn=n*n;
+    double mu=0;
+    double C[3]={0,0,0};
+    if(nn>0){
+        //projection p of the origin onto the plane, areas in the coordinate
+        //plane (x,y) with the largest normal component k: mu=n[k]
+        int k=0;
+        if(fabs(n[1])>fabs(n[k])) k=1;
+        if(fabs(n[2])>fabs(n[k])) k=2;
+        int x=next[k], y=next[x];
+        double h=(a*n)/nn;
+        double px=n[x]*h, py=n[y]*h;
+        mu=n[k];
+        C[0]=(b[x]-px)*(c[y]-py)-(b[y]-py)*(c[x]-px);
+        C[1]=(px-a[x])*(c[y]-a[y])-(py-a[y])*(c[x]-a[x]);
+        C[2]=(b[x]-a[x])*(py-a[y])-(b[y]-a[y])*(px-a[x]);
+        if(gjkSameSign(mu,C[0]) && gjkSameSign(mu,C[1]) && gjkSameSign(mu,C[2])){
+            double inv=1.0/mu;
+            gjkSetFeature(f,i0,C[0]*inv,i1,C[1]*inv,i2,C[2]*inv);
+            return;
+        }
+    }
+    //outside of edge bc, ca or ab (a degenerate triangle: all of them);
+    //outside of a single edge the closest point is on that edge
+    GJKFeature e[3];
+    int m=0;
+    if(!gjkSameSign(mu,C[0])) gjkS1D(s,i1,i2,e[m++]);
+    if(!gjkSameSign(mu,C[1])) gjkS1D(s,i0,i2,e[m++]);
+    if(!gjkSameSign(mu,C[2])) gjkS1D(s,i0,i1,e[m++]);
+    f=e[0];
+    if(m==1) return;
+    f.dist2=gjkDist2(s,f);
+    for(int j=1; j<m; j++){
+        e[j].dist2=gjkDist2(s,e[j]);
+        if(e[j].dist2<f.dist2) f=e[j];
+    }
+}
+
+// closest point of the tetrahedron w[0..3] to the origin; true if the
+// origin lies inside
+inline bool gjkS3D(const GJKSimplex& s, GJKFeature& f) {
+    const Vector3d& w0=s.v[0].w;
+    const Vector3d& w1=s.v[1].w;
+    const Vector3d& w2=s.v[2].w;
+    const Vector3d& w3=s.v[3].w;
+    //C[i]: volume with w[i] replaced by the origin, their sum the volume
+    Vector3d w23=w2%w3;
+    double C[4];
+    C[0]=w1*w23;
+    C[1]=-(w0*w23);
+    C[2]=w0*(w1%w3);
+    C[3]=-(w0*(w1%w2));
+    double det=C[0]+C[1]+C[2]+C[3];
+    //a flat tetrahedron has no inside, all faces are tested
+    double scale2=(w1-w0).lengthSquared()*(w2-w0).lengthSquared()*(w3-w0).lengthSquared();
+    if(det*det<=1e-24*scale2) det=0;
+    if(gjkSameSign(det,C[0]) && gjkSameSign(det,C[1]) && gjkSameSign(det,C[2]) && gjkSameSign(det,C[3])){
+        f.n=4;
+        for(int i=0; i<4; i++){
+            f.idx[i]=i;
+            f.l[i]=C[i]/det;
+        }
+        return true;
+    }
+    //outside of face j (a flat tetrahedron: all of them); outside of a
+    //single face the closest point is on that face
+    static const int face[4][3]={{1,2,3},{0,2,3},{0,1,3},{0,1,2}};
+    int out[4], m=0;
+    for(int j=0; j<4; j++){
+        if(!gjkSameSign(det,C[j])) out[m++]=j;
+    }
+    gjkS2D(s,face[out[0]][0],face[out[0]][1],face[out[0]][2],f);
+    if(m==1) return false;
+    f.dist2=gjkDist2(s,f);
+    for(int j=1; j<m; j++){
+        GJKFeature t;
+        gjkS2D(s,face[out[j]][0],face[out[j]][1],face[out[j]][2],t);
+        t.dist2=gjkDist2(s,t);
+        if(t.dist2<f.dist2) f=t;
+    }
+    return false;
+}
+
+// Reduces s to the smallest sub-simplex that contains the point closest to
+// the origin and sets its barycentric coordinates. Returns true if the
+// origin lies inside the tetrahedron (s is left with all four vertices).
+inline bool gjkSolve(GJKSimplex& s) {
+    GJKFeature best;
+    switch(s.n){
+    case 1:
+        s.lambda[0]=1.0;
+        return false;
+    case 2:
+        gjkS1D(s,0,1,best);
+        break;
+    case 3:
+        gjkS2D(s,0,1,2,best);
+        break;
+    default:
+        if(gjkS3D(s,best)){
+            for(int i=0; i<4; i++) s.lambda[i]=best.l[i];
+            return true;
+        }
+    }
+
+    GJKVertex v[3];
+    for(int i=0; i<best.n; i++) v[i]=s.v[best.idx[i]];
+    for(int i=0; i<best.n; i++){
+        s.v[i]=v[i];
+        s.lambda[i]=best.l[i];
+    }
+    s.n=best.n;
+    return false;
+}
+
+// Re-evaluates the cached simplex directions on the current shapes, vertex
+// by vertex like GJK itself. Returns true if the seed already encloses the
+// origin; v is the closest point of the seed simplex.
+template<class A, class B>
+bool gjkSeed(const A& a, const B& b, const GJKCache& cache, GJKSimplex& s, Vector3d& v, double& maxW2) {
+    s.n=0;
+    for(int i=0; i<cache.n; i++){
+        GJKVertex x=gjkSupport(a,b,cache.dir[i]);
+        bool known=false;
+        for(int j=0; j<s.n; j++) known=known || s.v[j].w==x.w;
+        if(known) continue;
+        maxW2=std::max(maxW2,x.w.lengthSquared());
+        s.add(x);
+        if(gjkSolve(s)) return true;
+    }
+    v=s.closest();
+    return false;
+}
+
+template<class A, class B>
+bool gjkIntersect(A a, B b, GJKCache* cache, int maxIterations) {
+    Vector3d v=a.center()-b.center();
+    if(cache && cache->valid){
+        //separating axis of the last query, usually still valid
+        GJKVertex x=gjkSupport(a,b,-cache->axis);
+        if(x.w*cache->axis>0) return false;
+        v=cache->axis;
+    }
+    if(v.lengthSquared()==0) v=Vector3d(1.0,0.0,0.0);
+    GJKSimplex s;
+    double last=-1;
+    double maxW2=0;
+    if(cache && cache->n>0){
+        if(gjkSeed(a,b,*cache,s,v,maxW2)) return true;
+        if(s.n==0 || v.lengthSquared()==0) v=cache->axis;
+    }
+    //also the answer at the iteration cap: cycling between nearly equal
+    //simplices only happens when touching
+    bool result=true;
+    for(int it=0; it<maxIterations; it++){
+        GJKVertex x=gjkSupport(a,b,-v);
+        //v separates: A-B lies completely on the far side of the origin
+        if(x.w*v>0){ result=false; break; }
+        maxW2=std::max(maxW2,x.w.lengthSquared());
+        s.add(x);
+        if(gjkSolve(s)){ result=true; break; }
+        Vector3d vn=s.closest();
+        double d2=vn.lengthSquared();
+        if(d2<=GJK_EPS*maxW2){ result=true; break; }
+        //no progress any more: the origin stays at distance |v|
+        if(last>=0 && d2>=last){ result=false; break; }
+        last=d2;
+        v=vn;
+    }
+    if(cache) cache->store(s,v);
+    return result;
+}
+
+// true if the shapes overlap (or touch within GJK_EPS)
+template<class A, class B>
+bool gjkIntersect(A a, B b, int maxIterations=64) {
+    return gjkIntersect(a,b,(GJKCache*)NULL,maxIterations);
+}
+
+// warm started: tries the cached separating axis first, then seeds GJK
+// with the simplex of the last query; updates the cache
+template<class A, class B>
+bool gjkIntersect(A a, B b, GJKCache& cache, int maxIterations=64) {
+    return gjkIntersect(a,b,&cache,maxIterations);
+}
+
+// gjkIntersect on a list of pairs (as[pairs[i].first],bs[pairs[i].second]),
+// e.g. the candidates of a broad phase: result[i] is 1 if the pair
+// overlaps. The queries are independent and spread over the cores.
+template<class A, class B>
+void gjkIntersectBatch(const std::vector<A>& as, const std::vector<B>& bs,
+                       const std::vector<std::pair<int,int> >& pairs,
+                       std::vector<char>& result, int maxIterations=64) {
+    int n=int(pairs.size());
+    result.resize(n);
+#pragma omp parallel for schedule(dynamic,64)
+    for(int i=0; i<n; i++){
+        result[i]=gjkIntersect(as[pairs[i].first],bs[pairs[i].second],maxIterations);
+    }
+}
+
+struct GJKResult {
+    enum Status {
+        SEPARATED,      // converged, distance > 0
+        INTERSECT,      // origin inside the simplex or touching
+        STALLED,        // no more progress, distance is the best found
+        MAX_ITERATIONS  // iteration cap hit
+    };
+    Status status;
+    // 0 when intersecting
+    double distance;
+    // closest points on A and B (witnesses), pointA-pointB = v
+    Vector3d pointA, pointB;
+    // closest point of A-B to the origin
+    Vector3d v;
+    int iterations;
+    // support queries of A-B, including those of a warm start seed
+    int supports;
+    // final simplex, a tetrahedron around the origin for INTERSECT
+    // unless the shapes only touch
+    GJKSimplex simplex;
+
+    bool intersect() const { return status==INTERSECT; }
+};
+
+template<class A, class B>
+double gjkDistance(A a, B b, GJKResult& r, GJKCache* cache, double eps, int maxIterations) {
+    GJKSimplex& s=r.simplex;
+    Vector3d v;
+    double maxW2=0;
+    r.status=GJKResult::MAX_ITERATIONS;
+    r.iterations=0;
+    r.supports=0;
+    s.n=0;
+    if(cache && cache->n>0){
+        r.supports+=cache->n;
+        if(gjkSeed(a,b,*cache,s,v,maxW2)) r.status=GJKResult::INTERSECT;
+    }
+    if(s.n==0){
+        v=cache && cache->valid ? -cache->axis : a.center()-b.center();
+        if(v.lengthSquared()==0) v=Vector3d(1.0,0.0,0.0);
+        s.add(gjkSupport(a,b,v));
+        s.lambda[0]=1.0;
+        v=s.v[0].w;
+        maxW2=v.lengthSquared();
+        r.supports++;
+    }
+    if(v.lengthSquared()==0) r.status=GJKResult::INTERSECT;
+    while(r.status==GJKResult::MAX_ITERATIONS && r.iterations<maxIterations){
+        r.iterations++;
+        r.supports++;
+        GJKVertex x=gjkSupport(a,b,-v);
+        double vv=v*v;
+        if(vv-v*x.w<=eps*vv){
+            r.status=GJKResult::SEPARATED;
+            break;
+        }
+        //a vertex that is already in the simplex cannot improve v
+        bool known=false;
+        for(int i=0; i<s.n; i++) known=known || s.v[i].w==x.w;
+        if(known){
+            r.status=GJKResult::STALLED;
+            break;
+        }
+        maxW2=std::max(maxW2,x.w.lengthSquared());
+        GJKSimplex old=s;
+        s.add(x);
+        if(gjkSolve(s)){
+            r.status=GJKResult::INTERSECT;
+            break;
+        }
+        Vector3d vn=s.closest();
+        if(vn.lengthSquared()<=GJK_EPS*maxW2){
+            r.status=GJKResult::INTERSECT;
+            v=vn;
+            break;
+        }
+        if(vn.lengthSquared()>=vv){
+            //rounding made it worse, keep the previous simplex
+            s=old;
+            r.status=GJKResult::STALLED;
+            break;
+        }
+        v=vn;
+    }
+
+    r.pointA=Vector3d();
+    r.pointB=Vector3d();
+    for(int i=0; i<s.n; i++){
+        r.pointA+=s.v[i].a*s.lambda[i];
+        r.pointB+=s.v[i].b*s.lambda[i];
+    }
+    r.v=r.intersect() ? Vector3d() : v;
+    r.distance=r.intersect() ? 0.0 : v.length();
+    if(cache) cache->store(s,r.v);
+    return r.distance;
+}
+
+// GJK distance: the point v of A-B closest to the origin is tracked with
+// barycentric coordinates on the simplex. Stops when v*w shows that no
+// support point can get closer by more than eps*|v| (relative), when the
+// simplex encloses the origin, when |v| stops decreasing, or after
+// maxIterations. Returns the distance, details in r.
+template<class A, class B>
+double gjkDistance(A a, B b, GJKResult& r, double eps=GJK_DISTANCE_EPS, int maxIterations=64) {
+    return gjkDistance(a,b,r,(GJKCache*)NULL,eps,maxIterations);
+}
+
+// warm started from the simplex of the last query of this pair; updates the cache
+template<class A, class B>
+double gjkDistance(A a, B b, GJKResult& r, GJKCache& cache, double eps=GJK_DISTANCE_EPS, int maxIterations=64) {
+    return gjkDistance(a,b,r,&cache,eps,maxIterations);
+}
+
+// counters over many gjkDistance calls
+struct GJKStats {
+    long long queries, iterations, supports, intersections, stalled, capped;
+    int max_iterations;
+
+    GJKStats() : queries(0), iterations(0), supports(0), intersections(0), stalled(0), capped(0), max_iterations(0) {}
+
+    void add(const GJKResult& r) {
+        queries++;
+        iterations+=r.iterations;
+        supports+=r.supports;
+        max_iterations=std::max(max_iterations,r.iterations);
+        if(r.status==GJKResult::INTERSECT) intersections++;
+        if(r.status==GJKResult::STALLED) stalled++;
+        if(r.status==GJKResult::MAX_ITERATIONS) capped++;
+    }
+
+    double average() const { return queries ? double(iterations)/queries : 0.0; }
+};
+
+#endif // GJK_H
@@ -0,0 +1,47 @@
+#ifndef POSE_H
+#define POSE_H
+
+#include "vecmath.h"
+
+// Rigid transform p -> q*p+t of an object whose vertex data stays in its
+// local frame: a unit quaternion and a translation. Moving the object
+// changes only these seven numbers.
+struct Pose {
+    Quat4d q;
+    Vector3d t;
+
+    Pose() {}
+    Pose(const Quat4d& q, const Vector3d& t) : q(q), t(t) {}
+
+    // local -> world
+    Vector3d apply(const Vector3d& p) const { return q*p+t; }
+    // world -> local
+    Vector3d applyInverse(const Vector3d& p) const { return q.conjugate()*(p-t); }
+    // directions only rotate
+    Vector3d toWorld(const Vector3d& d) const { return q*d; }
+    Vector3d toLocal(const Vector3d& d) const { return q.conjugate()*d; }
+
+    void translate(const Vector3d& d) { t+=d; }
+    // turn by angle (radians) about a world axis through the origin of the
+    // local frame
+    void turn(double angle, const Vector3d& axis) {
+        q=Quat4d(angle,axis)*q;
+        q.normalize();
+    }
+
+    // first b, then this
+    Pose operator*(const Pose& b) const { return Pose(q*b.q,q*b.t+t); }
+    Pose inverse() const {
+        Quat4d qi=q.conjugate();
+        return Pose(qi,-(qi*t));
+    }
+
+    // row-major like all Matrix4d, transpose() for glMultMatrixd
+    Matrix4d matrix() const {
+        Matrix4d M(q);
+        for(int k=0; k<3; k++) M(k,3)=t[k];
+        return M;
+    }
+};
+
+#endif // POSE_H
@@ -0,0 +1,118 @@
+#include "SupportMap.h"
+#include "ConvexHull.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+SupportMap::SupportMap() : last(-1) {
+    for(int k=0; k<6; k++) extreme[k]=0;
+}
+
+SupportMap::SupportMap(const std::vector<Vector3d>& input) : last(-1) {
+    set(input);
+}
+
+void SupportMap::set(const std::vector<Vector3d>& input) {
+    ConvexHull hull(input);
+    points=hull.points;
+    vertices=hull.vertices;
+    neighbourStart=hull.neighbourStart;
+    neighbours=hull.neighbours;
+    last=-1;
+
+    int n=size();
+    int padded=n+(n&1);
+    xs.resize(padded); ys.resize(padded); zs.resize(padded);
+    for(int i=0; i<padded; i++){
+        //the padding repeats the last vertex, scan() maps it back
+        const Vector3d& p=points[i<n ? i : n-1];
+        xs[i]=p[0]; ys[i]=p[1]; zs[i]=p[2];
+    }
+
+    for(int k=0; k<6; k++) extreme[k]=0;
+    for(int i=1; i<n; i++){
+        for(int k=0; k<3; k++){
+            if(points[i][k]<points[extreme[2*k]][k]) extreme[2*k]=i;
+            if(points[i][k]>points[extreme[2*k+1]][k]) extreme[2*k+1]=i;
+        }
+    }
+}
+
+int SupportMap::support(const Vector3d& d, int start, int* steps) const {
+    int n=size();
+    if(n==0) return -1;
+    if(n<SCAN_SIZE || neighbours.empty()){
+        if(steps) *steps+=n;
+        return scan(d);
+    }
+    if(start<0 || start>=n){
+        //cold start at the best of the axis extremes
+        start=extreme[0];
+        for(int k=1; k<6; k++){
+            if(points[extreme[k]]*d>points[start]*d) start=extreme[k];
+        }
+        if(steps) *steps+=6;
+    }
+    return climb(d,start,steps);
+}
+
+int SupportMap::climb(const Vector3d& d, int v, int* steps) const {
+    //steepest ascent: on a convex polytope a vertex without a better
+    //neighbour is a global maximum
+    double best=points[v]*d;
+    while(true){
+        int next=v;
+        for(int k=neighbourStart[v]; k<neighbourStart[v+1]; k++){
+            int w=neighbours[k];
+            double dw=points[w]*d;
+            if(dw>best){
+                best=dw;
+                next=w;
+            }
+        }
+        if(steps) *steps+=neighbourStart[v+1]-neighbourStart[v];
+        if(next==v) return v;
+        v=next;
+    }
+}
+
+int SupportMap::scan(const Vector3d& d) const {
+    int n=size();
+    int best=0;
+#ifdef __SSE2__
+    //two vertices per step, lane 0 even and lane 1 odd indices
+    __m128d dx=_mm_set1_pd(d[0]), dy=_mm_set1_pd(d[1]), dz=_mm_set1_pd(d[2]);
+    __m128d bestDot=_mm_set1_pd(-1e300);
+    __m128i bestIdx=_mm_setzero_si128();
+    //64 bit index per lane: lane 0 = i, lane 1 = i+1
+    __m128i idx=_mm_set_epi32(0,1,0,0);
+    __m128i two=_mm_set_epi32(0,2,0,2);
+    for(int i=0; i<int(xs.size()); i+=2){
+        __m128d dot=_mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&xs[i]),dx),
+                                          _mm_mul_pd(_mm_loadu_pd(&ys[i]),dy)),
+                               _mm_mul_pd(_mm_loadu_pd(&zs[i]),dz));
+        __m128d gt=_mm_cmpgt_pd(dot,bestDot);
+        bestDot=_mm_or_pd(_mm_and_pd(gt,dot),_mm_andnot_pd(gt,bestDot));
+        __m128i m=_mm_castpd_si128(gt);
+        bestIdx=_mm_or_si128(_mm_and_si128(m,idx),_mm_andnot_si128(m,bestIdx));
+        idx=_mm_add_epi64(idx,two);
+    }
+    double dots[2];
+    int ids[4];
+    _mm_storeu_pd(dots,bestDot);
+    _mm_storeu_si128((__m128i*)ids,bestIdx);
+    best=ids[0];
+    if(dots[1]>dots[0] || (dots[1]==dots[0] && ids[2]<ids[0])) best=ids[2];
+#else
+    double bestDot=points[0]*d;
+    for(int i=1; i<n; i++){
+        double dot=points[i]*d;
+        if(dot>bestDot){
+            bestDot=dot;
+            best=i;
+        }
+    }
+#endif
+    return best<n ? best : n-1;
+}
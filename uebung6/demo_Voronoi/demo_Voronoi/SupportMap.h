@@ -0,0 +1,63 @@
+#ifndef SUPPORTMAP_H
+#define SUPPORTMAP_H
+
+#include <vector>
+#include "vecmath.h"
+
+// Support mapping of a point cloud for GJK: s(d) = argmax_p p*d.
+// Only hull vertices can be support points, so the cloud is reduced to its
+// convex hull once. Queries hill-climb over the hull vertex adjacency,
+// starting at the vertex of the previous query: under small changes of d
+// the answer is found after a few steps. Small or flat hulls are scanned
+// linearly (SSE2, two vertices per step).
+class SupportMap {
+public:
+
+    // below this many hull vertices the linear scan is faster
+    enum { SCAN_SIZE = 64 };
+
+    SupportMap();
+    SupportMap(const std::vector<Vector3d>& input);
+
+    // rebuild from a new point cloud, resets the warm start
+    void set(const std::vector<Vector3d>& input);
+
+    // index of the hull vertex furthest in direction d. start is the hull
+    // vertex to climb from (e.g. the result of the previous query), -1 for
+    // a cold start. Does not modify the map, several threads may query it.
+    // steps (optional) is increased by the number of vertices looked at.
+    int support(const Vector3d& d, int start, int* steps=NULL) const;
+
+    // warm started query, remembers the result for the next call
+    const Vector3d& operator()(const Vector3d& d) {
+        last = support(d,last);
+        return points[last];
+    }
+
+    const Vector3d& point(int v) const { return points[v]; }
+    // index of hull vertex v in the input point cloud
+    int index(int v) const { return vertices[v]; }
+
+    int size() const { return int(points.size()); }
+    bool empty() const { return points.empty(); }
+
+private:
+
+    int scan(const Vector3d& d) const;
+    int climb(const Vector3d& d, int v, int* steps) const;
+
+    std::vector<Vector3d> points;
+    std::vector<int> vertices;
+    std::vector<int> neighbourStart;
+    std::vector<int> neighbours;
+
+    // hull vertices as SoA for the linear scan, padded to an even count
+    std::vector<double> xs, ys, zs;
+
+    // hull vertices with minimal and maximal x, y, z: cold start candidates
+    int extreme[6];
+
+    int last;
+};
+
+#endif // SUPPORTMAP_H
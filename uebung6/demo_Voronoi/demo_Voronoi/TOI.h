@@ -0,0 +1,137 @@
+#ifndef TOI_H
+#define TOI_H
+
+#include <algorithm>
+#include <cmath>
+#include "vecmath.h"
+#include "ConvexShapes.h"
+#include "GJK.h"
+
+// Time of impact of two moving shapes by conservative advancement: the GJK
+// distance d and normal n at time t, divided by an upper bound mu of the
+// speed with which any point of A can approach any point of B along n,
+// give a step t+=d/mu that cannot skip the first contact. Unlike sampling
+// the motion at discrete steps, thin or fast shapes cannot tunnel.
+
+// default distance at which the shapes count as touching
+const double TOI_TOLERANCE=1e-4;
+
+// Motion over the sweep interval t in [0,1]: a rotation by angle*t about
+// axis through pivot, followed by the translation linear*t. The shape
+// passed to timeOfImpact is the one at t=0.
+struct TOIMotion {
+    Vector3d linear;
+    Vector3d pivot;
+    Vector3d axis;
+    double angle;
+
+    // at rest
+    TOIMotion() : axis(0.0,0.0,1.0), angle(0.0) {}
+    // pure translation
+    TOIMotion(const Vector3d& linear) : linear(linear), axis(0.0,0.0,1.0), angle(0.0) {}
+    TOIMotion(const Vector3d& linear, const Vector3d& pivot, double angle, const Vector3d& axis)
+        : linear(linear), pivot(pivot), axis(axis), angle(angle) {}
+
+    Matrix4d at(double t) const {
+        Matrix4d M=Matrix4d::translate(pivot+linear*t);
+        if(angle!=0) M=M*Matrix4d::rotate(angle*t,axis);
+        return M*Matrix4d::translate(-pivot);
+    }
+};
+
+// radius of a sphere about p that contains the shape: the farthest corner
+// of the bounding box from the six axis supports
+template<class S>
+double toiRadius(const S& s, const Vector3d& p) {
+    double r2=0;
+    for(int k=0; k<3; k++){
+        Vector3d d;
+        d[k]=1.0;
+        double lo=s.support(-d)[k]-p[k];
+        double hi=s.support(d)[k]-p[k];
+        double m=std::max(std::fabs(lo),std::fabs(hi));
+        r2+=m*m;
+    }
+    return std::sqrt(r2);
+}
+
+struct TOIResult {
+    enum Status {
+        HIT,            // first contact at t
+        MISS,           // no contact for t in [0,1]
+        INTERSECT,      // already overlapping at t=0
+        MAX_ITERATIONS  // iteration cap hit, t is a safe time before contact
+    };
+    Status status;
+    double t;
+    // contact normal pointing from A to B, and the closest points at time t
+    Vector3d normal;
+    Vector3d pointA, pointB;
+    // GJK distance queries
+    int iterations;
+
+    bool hit() const { return status==HIT; }
+};
+
+// First time t in [0,1] at which A moving by ma and B moving by mb come
+// within tolerance of each other. Every step advances to a distance of
+// tolerance/2 under the speed bound, so pure translations finish after a
+// step or two; rotations converge linearly. Successive GJK queries are
+// warm started from the previous simplex. Returns r.t.
+template<class A, class B>
+double timeOfImpact(const A& a, const TOIMotion& ma, const B& b, const TOIMotion& mb, TOIResult& r,
+                    double tolerance=TOI_TOLERANCE, int maxIterations=64) {
+    // angle*axis is the angular velocity w over the unit interval; a point
+    // at distance rho from the pivot approaches along n with at most
+    // (w x r)*n = r*(n x w) <= rho*|n x w|
+    Vector3d wa, wb;
+    double rhoA=0, rhoB=0;
+    if(ma.angle!=0){
+        wa=ma.axis*(ma.angle/ma.axis.length());
+        rhoA=toiRadius(a,ma.pivot);
+    }
+    if(mb.angle!=0){
+        wb=mb.axis*(mb.angle/mb.axis.length());
+        rhoB=toiRadius(b,mb.pivot);
+    }
+    Vector3d linear=ma.linear-mb.linear;
+    double target=0.5*tolerance;
+
+    GJKCache cache;
+    GJKResult g;
+    r.status=TOIResult::MAX_ITERATIONS;
+    r.t=0;
+    r.iterations=0;
+    while(r.iterations<maxIterations){
+        r.iterations++;
+        gjkDistance(transformed(a,ma.at(r.t)),transformed(b,mb.at(r.t)),g,cache);
+        if(g.intersect()){
+            // only possible at the start, every step stops short of contact
+            if(r.iterations==1) r.status=TOIResult::INTERSECT;
+            else r.status=TOIResult::HIT;
+            break;
+        }
+        r.pointA=g.pointA;
+        r.pointB=g.pointB;
+        r.normal=(g.pointB-g.pointA)*(1.0/g.distance);
+        if(g.distance<=tolerance){
+            r.status=TOIResult::HIT;
+            break;
+        }
+        double mu=linear*r.normal+rhoA*(r.normal%wa).length()+rhoB*(r.normal%wb).length();
+        if(mu<=0){
+            r.t=1.0;
+            r.status=TOIResult::MISS;
+            break;
+        }
+        r.t+=(g.distance-target)/mu;
+        if(r.t>1.0){
+            r.t=1.0;
+            r.status=TOIResult::MISS;
+            break;
+        }
+    }
+    return r.t;
+}
+
+#endif // TOI_H
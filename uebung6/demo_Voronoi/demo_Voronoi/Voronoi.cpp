@@ -7,6 +7,7 @@
 #include <QKeyEvent>
 #include <QMessageBox>
 #include <QHBoxLayout>
+#include <QElapsedTimer>
 
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -14,6 +15,8 @@
 #include <sstream>
 #include <iostream>
 #include <limits>
+#include <string>
+#include <cstdlib>
 
 #include "Voronoi.h"
 
@@ -123,6 +126,11 @@ void CGMainWindow::loadPolyhedron() {
 
     file.close();
 
+    ogl->supportMap.set(ogl->P1);
+    ogl->pose1=Pose();
+    ogl->gjkCache.reset();
+    std::cout << "hull vertices      : " << ogl->supportMap.size() << std::endl;
+
     ogl->updateGL();
     statusBar()->showMessage ("Loading generator model done." ,3000);
 }
@@ -141,35 +149,6 @@ void CGMainWindow::loadPolyhedron() {
 //}
 
 
-void CGView::correctSimplexOrientation(std::vector<Vector3d> & simplex){
-
-    if(simplex.size() < 3)
-        return;
-
-    if(simplex.size() == 4) {
-        Vector3d a = simplex.at(0);
-        Vector3d b = simplex.at(1);
-        Vector3d c = simplex.at(2);
-        Vector3d d = simplex.at(3);
-        Vector3d n = (b-a)%(c-a);
-        if((d-a).dot(n) > 0){
-            simplex.at(1) = d;
-            simplex.at(3) = b;
-        }
-    }
-
-    if(simplex.size() == 3) {
-        Vector3d a = simplex.at(0);
-        Vector3d b = simplex.at(1);
-        Vector3d c = simplex.at(2);
-        Vector3d n = (b-a)%(c-a);
-        if((Vector3d(0,0,0)-a).dot(n) < 0){
-            simplex.at(0) = b;
-            simplex.at(1) = a;
-        }
-    }
-}
-
 void CGView::drawBoundingBox() {
     double maxX = 1;
     double maxY = 1;
@@ -207,64 +186,6 @@ void CGView::drawBoundingBox() {
 
 
 
-bool CGView::voronoiSurface(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b,
-                            const Vector3d &c, const Vector3d &normal){
-    Vector3d h1=(b-a)%normal;
-    Vector3d h2=(c-b)%normal;
-    Vector3d h3=(a-c)%normal;
-    if(((p-a)*h1<=0) && ((p-b)*h2<=0) && ((p-c)*h3<=0) && ((p-a)*normal>0)){
-        //Q.resize(3);
-        Q.push_back(a);
-        Q.push_back(b);
-        Q.push_back(c);
-        return true;
-    }
-    return false;
-}
-
-bool CGView::voronoiPoint(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b,
-                          const Vector3d &c){
-    if(((p-a)*(b-a)<=0) && ((p-a)*(c-a)<=0)){
-        Q.push_back(a);
-        return true;
-    }
-    return false;
-}
-
-bool CGView::voronoiPoint(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b,
-                          const Vector3d &c, const Vector3d &d){
-
-    if(((p-a)*(b-a)<=0) && ((p-a)*(d-a)<=0) && ((p-a)*(c-a)<=0)){
-        Q.push_back(a);
-        return true;
-    }
-    return false;
-}
-
-bool CGView::voronoiEdge(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b,
-                         const Vector3d &normal1, const Vector3d &normal2){
-
-    Vector3d h1=(a-b)%normal1;
-    Vector3d h2=(b-a)%normal2;
-    if(((p-a)*(b-a)>0) && ((p-b)*(a-b)>0) && (((p-a)*h1)<=0) && ((p-b)*h2<=0)){
-        Q.push_back(a);
-        Q.push_back(b);
-        return true;
-    }
-    return false;
-}
-
-bool CGView::voronoiEdge(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b){
-    Vector3d h=(b-a)%n_abc;
-
-    if((p-a)*h>=0){
-        Q.push_back(a);
-        Q.push_back(b);
-        return true;
-    }
-    return false;
-}
-
 Vector3d CGView::comTriangle(const Vector3d &a, const Vector3d &b,
                              const Vector3d &c){
     Vector3d com;
@@ -278,239 +199,13 @@ Vector3d CGView::comTriangle(const Vector3d &a, const Vector3d &b,
     return com=com/3;
 }
 
-void CGView::triangleNormal(const std::vector<Vector3d> &simplex){
-
-    if(simplex.size()==3){
-        n_abc=(simplex[1]-simplex[0])%(simplex[2]-simplex[0]);
-    }
-
-    if(simplex.size()==4){
-        n_abc=(simplex[1]-simplex[0])%(simplex[2]-simplex[0]);
-        n_bad=(simplex[3]-simplex[0])%(simplex[1]-simplex[0]);
-        n_bdc=(simplex[3]-simplex[1])%(simplex[2]-simplex[1]);
-        n_dac=(simplex[0]-simplex[3])%(simplex[2]-simplex[3]);
-    }
-}
-
-Vector3d CGView::support(const Vector3d &d){
-    Vector3d max;
-    float pd=-std::numeric_limits<float>::max();
-    for(unsigned int i=0; i<P1.size(); i++){
-        float pd_cur=P1[i]*d;
-        if(pd_cur>pd){
-            pd=pd_cur;
-            max=P1[i];
-        }
-    }
-    return max;
-}
-
-
-// find feature of Q closest to p and direction of feature closest to p
-bool CGView::simplexSolver(const Vector3d &p,
-                           std::vector<Vector3d> &Q,
-                           Vector3d &dir){
-
-
-    // Q.size() == 1 not interesting, as simplex in GJK will always be at least 2
-
-    /// %%%%%%%%%%%%%%%%%%%%%%%%
-    /// %%%%%%%%%%  Q=2  %%%%%%%
-    /// %%%%%%%%%%%%%%%%%%%%%%%%
-
-    if(Q.size() == 2){
-        Vector3d a = Q.at(0);
-        Vector3d b = Q.at(1);
-        Q.clear();
-
-        //Test if p is in V_a, V_b
-
-        if((p-a)*(b-a)<=0){
-            Q.push_back(a);
-            dir=p-a;
-            return false;
-        }
-        if((p-b)*(a-b)<=0){
-            Q.push_back(b);
-            dir=p-b;
-            return false;
-        }
-
-        //else: p is in V_ab
-
-        Q.push_back(a);
-        Q.push_back(b);
-        dir=((b-a)%(p-a))%(b-a);
-        return false;
-    }
-
-    /// %%%%%%%%%%%%%%%%%%%%%%%%
-    /// %%%%%%%%%%  Q=3  %%%%%%%
-    /// %%%%%%%%%%%%%%%%%%%%%%%%
-
-    if(Q.size() == 3){
-        Vector3d a = Q.at(0);
-        Vector3d b = Q.at(1);
-        Vector3d c = Q.at(2);
-        Q.clear();
-
-        //Test if p is in V_a, V_b, V_c
-
-        if(voronoiPoint(Q, p, a, b, c)){
-            dir=p-a;
-            return false;
-        }
-        if(voronoiPoint(Q, p, b, a, c)){
-            dir=p-b;
-            return false;
-        }
-        if(voronoiPoint(Q, p, c, a, b)){
-            dir=p-c;
-            return false;
-        }
-
-        //Test if p is in V_ab, V_ca, V_cb
-
-        if(voronoiEdge(Q, p, b, c)){
-            dir=((c-b)%(p-b))%(c-b);
-            return false;
-        }
-
-        if(voronoiEdge(Q, p, a, b)){
-            dir=((b-a)%(p-a))%(b-a);
-            return false;
-        }
-
-        if(voronoiEdge(Q, p, c, a)){
-            dir=((a-c)%(p-c))%(a-c);
-            return false;
-        }
-
-        //else: p is in V_abc
-
-        Q.push_back(a);
-        Q.push_back(b);
-        Q.push_back(c);
-        dir=n_abc;
-        return false;
-    }
-
-    /// %%%%%%%%%%%%%%%%%%%%%%%%
-    /// %%%%%%%%%%  Q=4  %%%%%%%
-    /// %%%%%%%%%%%%%%%%%%%%%%%%
-
-    if(Q.size() == 4){
-        Vector3d a = Q.at(0);
-        Vector3d b = Q.at(1);
-        Vector3d c = Q.at(2);
-        Vector3d d = Q.at(3);
-        Q.clear();
-
-        //Test if p is in V_a, V_b, V_c, V_d
-
-        if(voronoiPoint(Q, p, a, b, c, d)){
-            dir=p-a;
-            return false;
-        }
-        if(voronoiPoint(Q, p, b, a, c, d)){
-            dir=p-b;
-            return false;
-        }
-        if(voronoiPoint(Q, p, c, b, a, d)){
-            dir=p-c;
-            return false;
-        }
-        if(voronoiPoint(Q, p, d, b, c, a)){
-            dir=p-d;
-            return false;
-        }
-
-        //Test if p is in V_ab, V_bc, V_cd, V_da, V_ca, V_bd
-
-        if(voronoiEdge(Q, p, a, b, n_abc, n_bad)){
-            dir=((b-a)%(p-a))%(b-a);
-            return false;
-        }
-
-        if(voronoiEdge(Q, p, b, c, n_abc, n_bdc)){
-            dir=((c-b)%(p-b))%(c-b);
-            return false;
-        }
-
-        if(voronoiEdge(Q, p, b, d, n_bdc, n_bad)){
-            dir=((d-b)%(p-b))%(d-b);
-            return false;
-        }
-
-        if(voronoiEdge(Q, p, a, d, n_bad, n_dac)){
-            dir=((d-a)%(p-a))%(d-a);
-            return false;
-        }
-
-        if(voronoiEdge(Q, p, a, c, n_dac, n_abc)){
-            dir=((c-a)%(p-a))%(c-a);
-            return false;
-        }
-
-        if(voronoiEdge(Q, p, c, d,n_dac, n_bdc)){
-            dir=((d-c)%(p-c))%(d-c);
-            return false;
-        }
-
-        //Test if p is in V_abc, V_bdc, V_adb, V_dac
-
-        if(voronoiSurface(Q, p, a, b, c, n_abc)){
-            dir=n_abc;
-            return false;
-        }
-
-        if(voronoiSurface(Q, p, b, d, c, n_bdc)){
-            dir=n_bdc;
-            return false;
-        }
-
-        if(voronoiSurface(Q, p, a, d, b, n_bad)){
-            dir=n_bad;
-            return false;
-        }
-
-        if(voronoiSurface(Q, p, d, a, c, n_dac)){
-            dir=n_dac;
-            return false;
-        }
-
-        //else: p is in V_abcd
-
-        Q.push_back(a);
-        Q.push_back(b);
-        Q.push_back(c);
-        Q.push_back(d);
-        return true;
-    }
-    return false;
-}
-
 bool CGView::GJK(){
-
-    Vector3d dir=P1[0];
-    Vector3d v=support(dir);
-
-    Q.push_back(v);
-    dir=v*(-1);
-    Vector3d p=Vector3d(0.0,0.0,0.0);
-
-    while(true){
-        v=support(dir);
-        Q.push_back(v);
-        correctSimplexOrientation(Q);
-        triangleNormal(Q);
-        if(v*dir<0){
-            return false; //no intersection
-        }
-        if(simplexSolver(p,Q,dir)){
-            return true; //intersection
-        }
+    // distance of the origin to the hull of P1, see GJK.h
+    gjkDistance(posed(HullShape(supportMap),pose1),PointShape(Vector3d(0.0,0.0,0.0)),gjk,gjkCache);
+    if(gjk.intersect()){
+        epa(posed(HullShape(supportMap),pose1),PointShape(Vector3d(0.0,0.0,0.0)),gjk.simplex,penetration,epaWorkspace);
     }
+    return gjk.intersect();
 }
 
 
@@ -545,6 +240,9 @@ void CGView::paintGL() {
         if(GJK()) {
             color=Vector3d(1.0,0.0,0.0);
         }
+        // P1 is stored in its local frame
+        glPushMatrix();
+        glMultMatrixd(pose1.matrix().transpose().ptr());
         for(unsigned int i=0;i<P1.size();i++) {
 
 
@@ -570,6 +268,24 @@ void CGView::paintGL() {
             gluSphere( quadric , .01 , 10 , 10);
             glPopMatrix();
         }
+        glPopMatrix();
+
+        // shortest connection between hull and origin, or the shortest way
+        // out of the hull
+        glColor3d(1,0,1);
+        glBegin(GL_LINES);
+        if(!gjk.intersect()){
+            glVertex3dv(gjk.pointA.ptr());
+            glVertex3d(0.0,0.0,0.0);
+        }else{
+            glVertex3d(0.0,0.0,0.0);
+            glVertex3dv((penetration.normal*penetration.depth).ptr());
+        }
+        glEnd();
+        if(!gjk.intersect())
+            main->statusBar()->showMessage(QString("distance %1, %2 GJK iterations").arg(gjk.distance).arg(gjk.iterations));
+        else
+            main->statusBar()->showMessage(QString("penetration depth %1, %2 EPA iterations").arg(penetration.depth).arg(penetration.iterations));
     }
 
     //Draw triangular normals
@@ -697,42 +413,258 @@ void CGView::mouseMoveEvent(QMouseEvent* event) {
 
 void CGView::keyPressEvent( QKeyEvent * event) 
 {
+    Vector3d t;
+    double angle=0.0;
     switch (event->key()) {
-    case Qt::Key_Q :
-        for(unsigned int i=0; i<P1.size(); i++){
-            P1[i][0]-=0.1;
-        }
-        break;
-    case Qt::Key_W :
-        for(unsigned int i=0; i<P1.size(); i++){
-            P1[i][0]+=0.1;;
-        }
-        break;
-    case Qt::Key_E :
-        for(unsigned int i=0; i<P1.size(); i++){
-            P1[i][1]-=0.1;
+    case Qt::Key_A : angle=-0.1; break;
+    case Qt::Key_S : angle= 0.1; break;
+    case Qt::Key_Q : t[0]=-0.1; break;
+    case Qt::Key_W : t[0]= 0.1; break;
+    case Qt::Key_E : t[1]=-0.1; break;
+    case Qt::Key_R : t[1]= 0.1; break;
+    case Qt::Key_D : t[2]=-0.1; break;
+    case Qt::Key_F : t[2]= 0.1; break;
+    }
+    if(t!=Vector3d(0.0,0.0,0.0) || angle!=0.0){
+        // sweep the hull first (TOI.h): a step that would cross the origin
+        // stops on the surface, the next one goes inside
+        Vector3d axis(0.0,0.0,1.0);
+        TOIResult sweep;
+        timeOfImpact(posed(HullShape(supportMap),pose1),TOIMotion(t,pose1.t,angle,axis),
+                     PointShape(Vector3d(0.0,0.0,0.0)),TOIMotion(),sweep);
+        if(sweep.hit() && sweep.iterations>1){
+            t*=sweep.t;
+            angle*=sweep.t;
+        }
+        // only the pose changes, P1 and supportMap stay as loaded
+        pose1.turn(angle,axis);
+        pose1.translate(t);
+    }
+    updateGL();
+}
+
+static double uniform(double a, double b) {
+    return a+(b-a)*rand()/double(RAND_MAX);
+}
+
+static Matrix4d randomPose(double spread) {
+    Matrix4d M;
+    M.makeRotate(uniform(0,2*M_PI),Vector3d(uniform(-1,1),uniform(-1,1),uniform(-1,1)));
+    for(int k=0; k<3; k++) M(k,3)=uniform(-spread,spread);
+    return M;
+}
+
+// gjkDistance over all pairs of as and bs: time, iterations, termination
+template<class A, class B>
+static void benchmarkPairs(const char* name, const std::vector<A>& as, const std::vector<B>& bs) {
+    GJKStats stats;
+    GJKResult r;
+    double sum=0;
+    QElapsedTimer timer;
+    timer.start();
+    for(unsigned int i=0; i<as.size(); i++){
+        for(unsigned int j=0; j<bs.size(); j++){
+            sum+=gjkDistance(as[i],bs[j],r);
+            stats.add(r);
         }
-        break;
-    case Qt::Key_R :
-        for(unsigned int i=0; i<P1.size(); i++){
-            P1[i][1]+=0.1;;
+    }
+    qint64 ns=timer.nsecsElapsed();
+    std::cout << name << ": " << stats.queries << " pairs, " << ns/1000.0/stats.queries << " us/query, "
+              << stats.average() << " avg / " << stats.max_iterations << " max iterations, "
+              << stats.intersections << " intersecting, " << stats.stalled << " stalled, "
+              << stats.capped << " capped (mean distance " << sum/stats.queries << ")" << std::endl;
+
+    // penetration and contact points of the intersecting pairs
+    EPAWorkspace ws;
+    EPAResult e;
+    ContactManifold m;
+    long long pairs=0, iterations=0, capped=0, contacts=0;
+    qint64 epaNs=0, manifoldNs=0;
+    for(unsigned int i=0; i<as.size(); i++){
+        for(unsigned int j=0; j<bs.size(); j++){
+            if(!gjkIntersect(as[i],bs[j])) continue;
+            gjkDistance(as[i],bs[j],r);
+            if(!r.intersect()) continue;
+            timer.restart();
+            epa(as[i],bs[j],r.simplex,e,ws);
+            epaNs+=timer.nsecsElapsed();
+            timer.restart();
+            contactManifold(as[i],bs[j],m,ws);
+            manifoldNs+=timer.nsecsElapsed();
+            pairs++;
+            iterations+=e.iterations;
+            if(e.status==EPAResult::MAX_ITERATIONS) capped++;
+            contacts+=m.n;
         }
-        break;
-    case Qt::Key_D :
-        for(unsigned int i=0; i<P1.size(); i++){
-            P1[i][2]-=0.1;
+    }
+    if(pairs>0)
+        std::cout << "                 EPA " << epaNs/1000.0/pairs << " us, " << double(iterations)/pairs
+                  << " avg iterations, " << capped << " capped; manifold " << manifoldNs/1000.0/pairs << " us, "
+                  << double(contacts)/pairs << " avg points" << std::endl;
+}
+
+// Pairs (shapes[2i],shapes[2i+1]) over 100 frames in which the second one
+// drifts and turns a little: cold queries against queries warm started
+// from a per-pair GJKCache
+template<class S>
+static void benchmarkCoherence(const char* name, const std::vector<TransformedShape<S> >& shapes) {
+    GJKStats cold, warm;
+    GJKResult r;
+    qint64 coldNs=0, warmNs=0, coldBoolNs=0, warmBoolNs=0;
+    QElapsedTimer timer;
+    for(unsigned int i=0; i+1<shapes.size(); i+=2){
+        const TransformedShape<S>& a=shapes[i];
+        TransformedShape<S> b=shapes[i+1];
+        Vector3d step(uniform(-0.01,0.01),uniform(-0.01,0.01),uniform(-0.01,0.01));
+        Matrix4d turn;
+        turn.makeRotate(0.01,Vector3d(uniform(-1,1),uniform(-1,1),uniform(-1,1)));
+        GJKCache cache, boolCache;
+        for(int f=0; f<100; f++){
+            Vector3d t(b.M(0,3),b.M(1,3),b.M(2,3));
+            b.M=turn*b.M;
+            for(int k=0; k<3; k++) b.M(k,3)=t[k]+step[k];
+
+            timer.restart();
+            gjkDistance(a,b,r);
+            coldNs+=timer.nsecsElapsed();
+            cold.add(r);
+            timer.restart();
+            gjkDistance(a,b,r,cache);
+            warmNs+=timer.nsecsElapsed();
+            warm.add(r);
+
+            timer.restart();
+            gjkIntersect(a,b);
+            coldBoolNs+=timer.nsecsElapsed();
+            timer.restart();
+            gjkIntersect(a,b,boolCache);
+            warmBoolNs+=timer.nsecsElapsed();
         }
-        break;
-    case Qt::Key_F :
-        for(unsigned int i=0; i<P1.size(); i++){
-            P1[i][2]+=0.1;;
+    }
+    std::cout << name << " under small motion, " << cold.queries << " queries: distance cold " << cold.average() << " iterations / "
+              << double(cold.supports)/cold.queries << " supports / " << coldNs/1000.0/cold.queries << " us, warm "
+              << warm.average() << " / " << double(warm.supports)/warm.queries << " / " << warmNs/1000.0/warm.queries
+              << " us; intersect cold " << coldBoolNs/1000.0/cold.queries << " us, warm " << warmBoolNs/1000.0/warm.queries << " us" << std::endl;
+}
+
+// the pairs of as and bs with centers closer than 1.2 (what a broad phase
+// would report), resolved one by one and with gjkIntersectBatch
+template<class A, class B>
+static void benchmarkBatch(const char* name, const std::vector<A>& as, const std::vector<B>& bs) {
+    std::vector<std::pair<int,int> > pairs;
+    for(unsigned int i=0; i<as.size(); i++){
+        for(unsigned int j=0; j<bs.size(); j++){
+            if((as[i].center()-bs[j].center()).lengthSquared()<1.44) pairs.push_back(std::make_pair(int(i),int(j)));
         }
-        break;
     }
-    updateGL();
+    std::vector<char> single(pairs.size()), batch;
+    QElapsedTimer timer;
+    timer.start();
+    for(unsigned int i=0; i<pairs.size(); i++){
+        single[i]=gjkIntersect(as[pairs[i].first],bs[pairs[i].second]);
+    }
+    qint64 singleNs=timer.nsecsElapsed();
+    timer.restart();
+    gjkIntersectBatch(as,bs,pairs,batch);
+    qint64 batchNs=timer.nsecsElapsed();
+    int hits=0, mismatches=0;
+    for(unsigned int i=0; i<pairs.size(); i++){
+        hits+=single[i];
+        mismatches+=single[i]!=batch[i];
+    }
+    std::cout << name << " " << pairs.size() << " candidates, " << hits << " intersecting: one by one "
+              << singleNs/1000.0/pairs.size() << " us, batch " << batchNs/1000.0/pairs.size()
+              << " us per pair, " << mismatches << " different" << std::endl;
+}
+
+// Pairs (shapes[2i],shapes[2i+1]) where the first one flies roughly
+// towards the second and up to three times as far, turning by up to 3
+// radians: time of impact against sampling the motion at 5 discrete
+// steps, which misses contacts in between
+template<class S>
+static void benchmarkTOI(const char* name, const std::vector<TransformedShape<S> >& shapes) {
+    int queries=0, hits=0, capped=0, iterations=0, missed=0;
+    qint64 ns=0;
+    QElapsedTimer timer;
+    for(unsigned int i=0; i+1<shapes.size(); i+=2){
+        const TransformedShape<S>& a=shapes[i];
+        const TransformedShape<S>& b=shapes[i+1];
+        if(gjkIntersect(a,b)) continue;
+        Vector3d noise(uniform(-0.5,0.5),uniform(-0.5,0.5),uniform(-0.5,0.5));
+        TOIMotion m((b.center()-a.center())*uniform(1,3)+noise,a.center(),
+                    uniform(-3,3),Vector3d(uniform(-1,1),uniform(-1,1),uniform(-1,1)));
+        TOIResult r;
+        timer.restart();
+        timeOfImpact(a,m,b,TOIMotion(),r);
+        ns+=timer.nsecsElapsed();
+        queries++;
+        iterations+=r.iterations;
+        if(r.status==TOIResult::MAX_ITERATIONS) capped++;
+        if(!r.hit()) continue;
+        hits++;
+        bool seen=false;
+        for(int k=1; k<=5 && !seen; k++){
+            seen=gjkIntersect(transformed(a,m.at(k/5.0)),b);
+        }
+        if(!seen) missed++;
+    }
+    std::cout << name << " swept, " << queries << " queries: " << hits << " hits, " << double(iterations)/queries
+              << " GJK calls / " << ns/1000.0/queries << " us per query, " << capped << " capped; "
+              << missed << " hits missed by 5 discrete steps" << std::endl;
+}
+
+// random convex pairs of unit size in a box of edge 4
+static void benchmarkGJK() {
+    srand(1);
+    const int N=200;
+
+    std::vector<Vector3d> cloud;
+    for(int i=0; i<20000; i++){
+        Vector3d p(uniform(-1,1),uniform(-1,1),uniform(-1,1));
+        if(p.lengthSquared()<=1) cloud.push_back(p*0.5);
+    }
+    SupportMap hull(cloud);
+    std::cout << "GJK benchmark, hull with " << hull.size() << " of " << cloud.size() << " points" << std::endl;
+
+    std::vector<TransformedShape<HullShape> > hulls;
+    std::vector<SphereShape> spheres;
+    std::vector<TransformedShape<BoxShape> > boxes;
+    std::vector<CapsuleShape> capsules;
+    for(int i=0; i<N; i++){
+        hulls.push_back(transformed(HullShape(hull),randomPose(2)));
+        spheres.push_back(SphereShape(Vector3d(uniform(-2,2),uniform(-2,2),uniform(-2,2)),uniform(0.1,0.5)));
+        boxes.push_back(transformed(BoxShape(Vector3d(),Vector3d(uniform(0.1,0.5),uniform(0.1,0.5),uniform(0.1,0.5))),randomPose(2)));
+        Vector3d c(uniform(-2,2),uniform(-2,2),uniform(-2,2));
+        Vector3d h(uniform(-0.4,0.4),uniform(-0.4,0.4),uniform(-0.4,0.4));
+        capsules.push_back(CapsuleShape(c-h,c+h,uniform(0.05,0.3)));
+    }
+
+    benchmarkPairs("hull-hull      ",hulls,hulls);
+    benchmarkPairs("hull-sphere    ",hulls,spheres);
+    benchmarkPairs("hull-box       ",hulls,boxes);
+    benchmarkPairs("box-box        ",boxes,boxes);
+    benchmarkPairs("box-capsule    ",boxes,capsules);
+    benchmarkPairs("capsule-sphere ",capsules,spheres);
+    benchmarkPairs("sphere-sphere  ",spheres,spheres);
+
+    benchmarkCoherence("hull-hull",hulls);
+    benchmarkCoherence("box-box  ",boxes);
+
+    benchmarkBatch("hull-hull     ",hulls,hulls);
+    benchmarkBatch("box-box       ",boxes,boxes);
+    benchmarkBatch("box-capsule   ",boxes,capsules);
+    benchmarkBatch("sphere-sphere ",spheres,spheres);
+
+    benchmarkTOI("hull-hull",hulls);
+    benchmarkTOI("box-box  ",boxes);
 }
 
 int main (int argc, char **argv) {
+    if (argc == 2 && std::string(argv[1]) == "-gjk") {
+        benchmarkGJK();
+        return 0;
+    }
+
     QApplication app(argc, argv);
 
     if (!QGLFormat::hasOpenGL()) {
@@ -19,6 +19,9 @@
 #endif
 
 #include "vecmath.h"
+#include "GJK.h"
+#include "EPA.h"
+#include "TOI.h"
 
 #ifndef VECMATH_VERSION
 #error "wrong vecmath included, must contain a VECMATH_VERSION macro"
@@ -75,13 +78,18 @@ public:
     void worldCoord(int x, int y, int z, Vector3d &v);
 
     Vector3d min, max, center;	// min, max and center of the coords of the loaded model
-    Vector3d n_abc, n_bad, n_bdc, n_dac;
     double zoom;
     bool wireframe_on, bbox_on;
 
     bool show_circle;
     int vn,fn,en;
     std::vector<Vector3d> P1;
+    // support mapping of P1 (hull + hill climbing), warm started by GJK
+    SupportMap supportMap;
+    // placement of P1 and supportMap, which stay in their local frame
+    Pose pose1;
+    // simplex and axis of the last frame, the hull only moves a little
+    GJKCache gjkCache;
 
     unsigned int picked;
 
@@ -103,9 +111,6 @@ protected:
     GLUquadric *quad;
     Quat4d q_now;
 
-    std::vector<Vector3d> Q;
-    std::vector<Vector3d> feature;
-
     Vector3d direction;
     Vector3d sphere_center;
 
@@ -116,25 +121,14 @@ protected:
     int VoronoiCellSize;
 
 
-    bool simplexSolver(const Vector3d &p,
-                       std::vector<Vector3d> &Q,
-                       Vector3d &dir);
-    bool voronoiSurface(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b,
-                        const Vector3d &c, const Vector3d &normal);
-    bool voronoiEdge(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b, const Vector3d &normal1, const Vector3d &normal2);
-    bool voronoiEdge(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b);
-    bool voronoiPoint(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b,
-                      const Vector3d &c, const Vector3d &d);
-    bool voronoiPoint(std::vector<Vector3d> &Q, const Vector3d &p, const Vector3d &a, const Vector3d &b,
-                      const Vector3d &c);
     Vector3d comTriangle(const Vector3d &a, const Vector3d &b,
                  const Vector3d &c);
-    Vector3d support(const Vector3d &d);
-    void triangleNormal(const std::vector<Vector3d> &simplex);
+    // does the hull of P1 contain the origin (GJK.h), distance and
+    // witness point in gjk, depth and normal in penetration (EPA.h)
     bool GJK();
-
-    void randomSimplex();
-    void correctSimplexOrientation(std::vector<Vector3d> & simplex);
+    GJKResult gjk;
+    EPAResult penetration;
+    EPAWorkspace epaWorkspace;
 
 public slots:
 